@@ -0,0 +1,6 @@
+//Stress program for the engines: loops where both pointers are on the same cell or cross each
+//other including one that subtracts from a cell through both of them
+>A>A>A>A>A>A>A>A>A>A>B>B>B>B>B>B>B>B>B>B+A+A+A+A+A[A-A>B+B+B<B]A>B.B[B-B+A]B.A+B
++B+B+B+B+B<B[A-A-B]A.A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A[A>B+B-A]A.A.B<B<B
+<B<B<B<B<B<B<B<B<B<B<B<B<B<B<B<B<B<B[B.B>B]B+A+A+A[A>B>B[B-B+A+A]B<B<B-A]A.A.B,A
+.A,B.B,A.A
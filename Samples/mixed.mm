@@ -0,0 +1,4 @@
+//Stress program for the engines: loops that test one pointer on entry and the other on exit
+//some of them never entered while the other pointer is on a cell that is not zero
+>A>A<A>B<A+A[B]A[A>A]A,A.A.B>A.A
+>A>A>A>B<B+B>A-B<A<A<B<A>B>B>B,A<B<A[A]B[B>A>B]B-A.A.B<A.A>A>A.A
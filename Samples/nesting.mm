@@ -0,0 +1,29 @@
+//Stress program for the engines: 100 nested loops that alternate between the pointers
+//run 10000 times with an output each time
+//It reads a byte first so that compiling it does not evaluate it ahead
+>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B
+>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B
+>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B
+>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B>B,B[B-B]B+A+A+A+A+A+A
++A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A
++A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A
++A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A
++A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A
++A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A[A>A+A+A+A+A
++A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A+A
++A+A+A+A+A+A[A>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A
+>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A
++A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B
+[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A
+>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A
++A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B
+[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A
+>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>A+A[A>B+B[B>B>B+B.B<B<B-B]B<B-A]A<A-B
+]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A
+<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B
+-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B
+]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A
+<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B
+-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B
+]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A<A-B]B<B-A]A
+<A-B]B<B-A]A<A-B]B<B-A]A<A-A]A<A-A]A
@@ -0,0 +1,4 @@
+//Stress program for the engines: loops whose closing pointer is on a cell that is not zero once the opening
+//pointer is on a zero cell so that they run their body again without testing the opening pointer
+>B+A+B+B[A-A-B]B.A.B
+>A>A>B>B>B<B<B+A[A-B,A>A>B<B]B.A.B
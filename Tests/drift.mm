@@ -0,0 +1 @@
+-A[A>A-A[A>A-A[A>A-A[A>B-A]A<A-A]A<A-A]A<A-A]A+B.B
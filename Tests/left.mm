@@ -0,0 +1 @@
+<A+A.A
@@ -0,0 +1,73 @@
+#!/bin/sh
+# The checks make check runs, for what the samples' --differential runs can't cover: programs that have to stop
+# with an error, and files that have to be refused. Run from the repository's root, after make.
+failed=0
+
+# expect_error MESSAGE COMMAND...: COMMAND has to fail with exit(-1), not crash on a signal, and report MESSAGE on stderr
+expect_error()
+{
+	message=$1; shift
+	"$@" </dev/null >/dev/null 2>Tests/stderr.txt
+	status=$?
+	if [ $status -ne 255 ] || ! grep -q "$message" Tests/stderr.txt; then
+		echo "FAILED (exit status $status): $*"; cat Tests/stderr.txt; failed=1
+	else
+		echo "ok: $*"
+	fi
+	rm -f Tests/stderr.txt
+}
+
+# A loop that moves B a cell further each iteration without touching it, until it is far past the guard pages
+for engine in chars tokens threaded jit tiered; do
+	expect_error "moved past the last cell" ./MindMeld --engine=$engine Tests/drift.mm
+done
+expect_error "moved past the last cell" ./MindMeld --no-optimize --engine=jit Tests/drift.mm
+expect_error "moved past the last cell" ./MindMeld --stream Tests/drift.mm
+
+# A batch job leaving its tape fails on its own, and the batch still runs the others and reports them all
+printf 'Tests/left.mm - Tests/left.out\nTests/drift.mm - Tests/drift.out\nSamples/runs.mm - Tests/runs.out\n' > Tests/batch.txt
+for snapshot in "" --snapshot; do
+	./MindMeld --batch Tests/batch.txt $snapshot >Tests/stdout.txt 2>&1
+	if [ $? -ne 255 ] || ! grep -q "3 jobs, 2 failed" Tests/stdout.txt || ! grep -q "left.out: .*Data pointer moved left" Tests/stdout.txt \
+	   || [ "$(head -c 1000 Tests/runs.out)" != "$(./MindMeld Samples/runs.mm </dev/null | tail -n +2 | head -c 1000)" ]; then
+		echo "FAILED: ./MindMeld --batch $snapshot"; cat Tests/stdout.txt; failed=1
+	else
+		echo "ok: ./MindMeld --batch $snapshot"
+	fi
+done
+rm -f Tests/batch.txt Tests/stdout.txt Tests/*.out
+
+# The trace of a run that leaves its tape after reading input still has that input, and replays up to the error
+printf ',A.A<A.A' > Tests/traced.mm
+printf 'z' > Tests/traced.in
+for checked in "" --checked; do
+	expect_error "moved left" ./MindMeld $checked --trace Tests/traced.mmt --input Tests/traced.in Tests/traced.mm
+	expect_error "moved left" ./MindMeld $checked --replay Tests/traced.mmt Tests/traced.mm
+done
+# Only a checked tape writes out the output before the error, a guard page exits without it
+if ! ./MindMeld --checked --replay Tests/traced.mmt Tests/traced.mm </dev/null 2>/dev/null | grep -q z; then
+	echo "FAILED: ./MindMeld --checked --replay Tests/traced.mmt left out the input"; failed=1
+fi
+rm -f Tests/traced.mm Tests/traced.in Tests/traced.mmt
+
+# A compiled program whose loops jump to each other in pairs, but cross instead of nesting: the [ at token 1 with
+# the ] at token 4, and the [ at token 2 with the ] at token 5. Each token is 27 bytes from byte 59, its jump at 11.
+printf '+A[A[A-A]A]A' > Tests/crossed.mm
+./MindMeld --no-optimize --compile-only -o Tests/crossed.mmc Tests/crossed.mm </dev/null >/dev/null
+for token in 1 2 4 5; do
+	printf '\003' | dd of=Tests/crossed.mmc bs=1 seek=$((59 + 27 * token + 11)) conv=notrunc 2>/dev/null
+done
+expect_error "Corrupt compiled program: invalid token 4" ./MindMeld Tests/crossed.mmc
+rm -f Tests/crossed.mm Tests/crossed.mmc
+
+# A compiled program whose prefix goes on from the middle of an instruction: the code position it saved, past the
+# header, the sanitized source, the tokens and the prefix's own two flags, patched to 1, where the amount +A+A adds is
+printf '+A+A.A,A.A' > Tests/prefix.mm
+./MindMeld --compile-only -o Tests/prefix.mmc Tests/prefix.mm </dev/null >/dev/null
+characters=$(od -An -tu8 -j31 -N8 Tests/prefix.mmc | tr -d ' ')
+tokens=$(od -An -tu8 -j39 -N8 Tests/prefix.mmc | tr -d ' ')
+printf '\001' | dd of=Tests/prefix.mmc bs=1 seek=$((47 + characters + 27 * tokens + 2)) conv=notrunc 2>/dev/null
+expect_error "Corrupt compiled program: invalid prefix" ./MindMeld Tests/prefix.mmc
+rm -f Tests/prefix.mm Tests/prefix.mmc
+
+exit $failed
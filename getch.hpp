@@ -6,7 +6,7 @@
 
 static struct termios old, new_termios;
 
-char _getch(void)
+inline char _getch(void)
 {
     tcgetattr(0, &old); /* grab old terminal i/o settings */
     new_termios = old; /* make new_termios settings same as old settings */
@@ -18,7 +18,7 @@ char _getch(void)
     return ch;
 }
 
-char getch(void)
+inline char getch(void)
 {
     char c = _getch();
     return c == '\n' ? '\r' : c;
@@ -30,402 +30,1176 @@
  *              move the instruction pointer backward to the matching open bracket (Either [A or [B is acceptable)
  *              Otherwise, move the instruction pointer forward to the next instruction
  */
-#include <cassert>
+#include "mindmeld.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
-#include <cstdint>
+#include <deque>
 #include <fstream>
 #include <iostream>
-#include <memory>
-#include <vector>
+#include <map>
+#include <mutex>
+#include <numeric>
 #include <sstream>
-#include <stack>
-#include <utility>
+#include <thread>
 #ifdef _WIN32
 #include <conio.h>
+#include <io.h>
 #endif
 #ifdef __unix
+#include <unistd.h>
 #include "getch.hpp"
 #endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+bool SWITCH = false;
+Engine ENGINE = Engine::CHARS;
+bool OPTIMIZE = true;
+bool UNBUFFERED = false;
+std::string INPUT_PATH; // Read the program's input from this file instead of stdin
+InputSource::Eof EOF_MODE = InputSource::Eof::MAX; // getchar()'s EOF, as stored by getch()
+std::string EMIT_C; // Path of the C file to write instead of running the program
+uint64_t TAPE_SIZE = 1 << 26; // Cells on the tape, only backed by memory once the program uses them
+unsigned CELL_BITS = 8; // The width of the cells of the programs compiled here, saved programs keep their own
+int BENCH_RUNS = 0; // Time this many runs of the program instead of running it once
+std::string BENCH_CSV; // Append the benchmark's results to this CSV file
+bool DIFFERENTIAL = false; // Run the program on every engine, and check that their output and final tape agree
+std::string PERF_BASELINE; // Fail --differential --bench where an engine got slower than in this --bench-csv file
+double PERF_TOLERANCE = 25; // By more than this many percent of its median there
+const double PERF_NOISE_MS = 1; // And by more than this, as the timings of shorter runs are mostly noise
+std::string PROFILE; // Profile the token engine, and write the loops' folded stacks to this file
+std::string PERF_STATS; // Count the run's hardware events and interpreter stats, and write them to this file as JSON
+bool CHECKED = false; // Check every tape access, on the tokens engine, rather than relying on guard pages
+std::string BATCH; // Run the jobs listed in this manifest instead of a single program
+bool SNAPSHOT = false; // Run each source of the batch up to its first input once, and start its jobs from there
+bool COMPILE_ONLY = false; // Save the compiled program to OUTPUT_PATH instead of running it
+std::string OUTPUT_PATH;
+std::string CACHE_DIR; // Keep the compiled programs here, to skip compiling sources that didn't change
+bool STREAM = false; // Start running the source while it is still being tokenized
+std::string TRACE; // Record the run's trace to this file
+std::string REPLAY; // Replay the run recorded in this trace, instead of running the program on new input
+uint64_t SEEK = UINT64_MAX; // Stop the replay before this step, started from the last checkpoint before it
+Limits LIMITS; // How long programs may run, from --max-steps and --timeout
+const int LIMIT_EXIT_STATUS = 124; // The exit status of a program stopped by its limits, as timeout(1) has it
 
-enum class InstrType // Represents a BrainF**k instruction
+//Whether the program's output goes straight to a console
+static bool stdout_is_terminal()
 {
-    PLUS,
-    MINUS,
-    LEFT,
-    RIGHT,
-    INPUT,
-    OUTPUT,
-    LOOP_OPEN,
-    LOOP_CLOSE
-};
+#ifdef _WIN32
+    return _isatty(_fileno(stdout));
+#else
+    return isatty(STDOUT_FILENO);
+#endif
+}
 
-enum class Ptr { A, B }; // Designates which pointer to affect
+//Whether the program's input is typed on a console
+static bool stdin_is_terminal()
+{
+#ifdef _WIN32
+    return _isatty(_fileno(stdin));
+#else
+    return isatty(STDIN_FILENO);
+#endif
+}
 
-// Represents an (Instruction, Pointer) pair, with a special case for loops
-struct Instr
+//The name --engine= selects engine by
+static const char *engine_name(Engine engine)
 {
-    InstrType type;
-    Ptr ptr;
-    uint64_t jump = 0;
-};
+    switch(engine)
+    {
+        case Engine::CHARS:
+            return "chars";
+        case Engine::TOKENS:
+            return "tokens";
+        case Engine::THREADED:
+            return "threaded";
+        case Engine::JIT:
+            return "jit";
+        case Engine::TIERED:
+            return "tiered";
+    }
+    return "";
+}
 
-//Pre-processing functions
-std::string source_read(const std::string & filename);
-std::string source_sanitize(const std::string & source);
-std::string switch_sanitize(const std::string & source);
+//Why a run of the program, on a tape checked as given, can't use the selected engine, which run() falls back to the
+//tokens engine for
+static const char *fallback_reason(const Program & program, bool checked)
+{
+    if(LIMITS.max_steps || LIMITS.timeout_ms)
+        return "only the tokens engine enforces --max-steps and --timeout";
+    if(SNAPSHOT)
+        return "only the tokens engine starts from a --snapshot";
+    if(checked && !BATCH.empty())
+        return "only the tokens engine checks the tape's bounds, which stops just the job that leaves its tape";
+    if(checked)
+        return CHECKED ? "only the tokens engine checks the tape's bounds for --checked"
+                       : "only the tokens engine checks the tape's bounds, and the tape has no guard pages";
+    if(program.cell_bits != 8)
+        return "the JIT only compiles 8-bit cells";
+    return "JIT unavailable on this platform";
+}
 
-void tokenize(const std::string & source, std::vector<Instr> & out);
+//A tape of TAPE_SIZE of the program's cells
+static uint64_t tape_bytes(const Program & program)
+{
+    return TAPE_SIZE * (program.cell_bits / 8);
+}
 
-//Execution function
-void execute(const char *instructions);
-void execute_tokens(const std::vector<Instr> & instructions);
+//The program without its prefix, for the runs that measure or compare the engines: they have to take every
+//step of its run, rather than replay the part compile() evaluated
+static Program without_prefix(Program program)
+{
+    program.prefix.reset();
+    return program;
+}
 
-bool SWITCH = false;
-bool TOKENS = false;
+//End the interpreter with the error that stopped the program, after what the program output so far
+static void stop_program(OutputSink & out, const std::exception & error, int status)
+{
+    out.flush();
+    std::cout << std::flush;
+    std::cerr << std::endl << error.what() << std::endl;
+    exit(status);
+}
 
-int main(int argc, char * argv[])
+//Run the program once on the selected engine, and return the engine it ran on. A program stopped by its
+//limits, or for leaving a checked tape, ends the interpreter, with what it output so far.
+static Engine run_program(const Program & program, Tape & tape, InputSource & in, OutputSink & out, RunStats *stats = nullptr)
 {
-    std::string path;
-    for(int arg_pos = 1; arg_pos < argc; arg_pos++)
+    Engine ran;
+    try
     {
-        if(std::string(argv[arg_pos]) == "--switch")
-            SWITCH = true;
-        else if(std::string(argv[arg_pos]) == "--tokens")
-            TOKENS = true;
-        else
-            path = std::string(argv[arg_pos]);
+        ran = run(program, tape, in, out, ENGINE, LIMITS, stats);
     }
-    if(argc == 0)
+    catch(const LimitExceeded & error)
     {
-        std::cout << "Enter a path to a MindMeld source file: ";
-        getline(std::cin, path);
+        stop_program(out, error, LIMIT_EXIT_STATUS);
     }
-    std::string raw_source(source_read(path));
-    std::string instructions;
-    if(SWITCH)
-        instructions = std::string(switch_sanitize(raw_source));
-    else
-        instructions = std::string(source_sanitize(raw_source));
-    std::cout << instructions << std::endl;
-    if(TOKENS)
+    catch(const TapeError & error)
     {
-        std::vector<Instr> tokens;
-        tokenize(instructions, tokens);
-        execute_tokens(tokens);
+        stop_program(out, error, -1);
     }
-    else
+    if(ran != ENGINE)
     {
-        execute(instructions.c_str());
+        static bool warned = false;
+        if(!warned)
+            std::cerr << "Running on the tokens engine: " << fallback_reason(program, tape.checked()) << std::endl;
+        warned = true;
     }
-    std::cout << std::endl << "Press any key to continue..." << std::endl;
-    getch();
-    return 0;
+    return ran;
 }
 
-//Reads the given file, sanitizes it, and returns a cstring of instruction characters
-std::string source_read(const std::string & filename)
+// The hardware events a HardwareCounter can count
+enum class HardwareEvent { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_READ_MISSES };
+
+// Counts a hardware event of this process in user space, such as the CPU instructions it retires,
+// where the kernel allows it
+class HardwareCounter
 {
-    std::fstream source(filename, source.in);
-    if(source){
-        //Get the number of chars in the file
-        source.seekg (0, source.end);
-        uint64_t length = source.tellg();
-        source.seekg (0, source.beg);
-
-        //Read the file into a char array
-        char *contents = new char[length+1];
-        source.read(contents, length);
-        contents[strlen(contents)]='\0';
-        return std::string(contents);
-    } else {
-        std::cerr << "Could not read " << filename << std::endl;
-        std::cout << "Press any key to continue..." << std::endl;
-        getch();
+public:
+    explicit HardwareCounter(HardwareEvent event)
+    {
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        switch(event)
+        {
+            case HardwareEvent::CYCLES:
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case HardwareEvent::INSTRUCTIONS:
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case HardwareEvent::BRANCH_MISSES:
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case HardwareEvent::L1D_READ_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+        }
+        // With more events than hardware counters the kernel takes turns, and the counts are scaled up
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        (void)event;
+#endif
+    }
+    ~HardwareCounter()
+    {
+#ifdef __linux__
+        if(fd >= 0)
+            close(fd);
+#endif
+    }
+    HardwareCounter(const HardwareCounter &) = delete;
+    HardwareCounter & operator=(const HardwareCounter &) = delete;
+
+    bool available() const { return fd >= 0; }
+    void start()
+    {
+#ifdef __linux__
+        if(fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    uint64_t stop() // The events counted since start()
+    {
+        uint64_t count = 0;
+#ifdef __linux__
+        if(fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t values[3]; // The count, the time enabled and the time running
+            if(read(fd, values, sizeof(values)) == sizeof(values))
+                count = values[2] && values[2] < values[1] ? (uint64_t)((double)values[0] * values[1] / values[2]) : values[0];
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+//Open --input from the start, or an empty input without it, for one of several runs that all read the same
+static FILE *open_fixed_input()
+{
+    FILE *input_file = INPUT_PATH.empty() ? tmpfile() : fopen(INPUT_PATH.c_str(), "rb");
+    if(!input_file)
+    {
+        std::cerr << "Could not read " << (INPUT_PATH.empty() ? "an empty input" : INPUT_PATH) << std::endl;
         exit(-1);
     }
+    return input_file;
 }
 
-//Remove invalid characters from the raw source
-std::string source_sanitize(const std::string & source)
+//Run the program BENCH_RUNS times with its output discarded, report how long the runs took, and return their
+//median in milliseconds. Every run gets a fresh tape, and reads --input from the start, or no input at all.
+static double bench(const std::string & path, const Program & compiled)
 {
-    std::ostringstream stream;
-    bool lastWasAB = false;
-    for(const char c : source)
-    {
-        switch(c){
-            case 'A':
-            case 'B': // FALLTHROUGH
-                if(lastWasAB)
-                    continue;
-                lastWasAB = true;
-                stream << c;
-                break;
-
-            case '<':
-            case '>': // FALLTHROUGH
-            case '-': // FALLTHROUGH
-            case '+': // FALLTHROUGH
-            case '.': // FALLTHROUGH
-            case ',': // FALLTHROUGH
-            case '[': // FALLTHROUGH
-            case ']': // FALLTHROUGH
-                lastWasAB = false;
-                stream << c;
-                break;
+    const Program program = without_prefix(compiled);
+    std::vector<double> times; // Milliseconds
+    uint64_t retired = 0;
+    HardwareCounter counter(HardwareEvent::INSTRUCTIONS);
+    std::ostream discard(nullptr);
+    Tape tape(tape_bytes(program), CHECKED);
+    for(int run = 0; run < BENCH_RUNS; run++)
+    {
+        FILE *input_file = open_fixed_input();
+        {
+            InputSource in(input_file, false, EOF_MODE);
+            OutputSink out(discard, true, false);
+            tape.reset();
+            auto start = std::chrono::steady_clock::now();
+            counter.start();
+            run_program(program, tape, in, out);
+            out.flush();
+            retired += counter.stop();
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
         }
+        fclose(input_file);
+    }
+    const double total = std::accumulate(times.begin(), times.end(), 0.0);
+    std::sort(times.begin(), times.end());
+    const double min = times.front();
+    const double median = times[(times.size() - 1) / 2];
+    const double p99 = times[(size_t)std::ceil(times.size() * 0.99) - 1];
+    const uint64_t per_run = retired / BENCH_RUNS;
+    const double per_second = total > 0 ? retired / (total / 1000) : 0;
+
+    std::cout << path << " on " << engine_name(ENGINE) << ", " << BENCH_RUNS << " runs" << std::endl;
+    std::cout << "  min " << min << " ms, median " << median << " ms, p99 " << p99 << " ms" << std::endl;
+    if(counter.available())
+        std::cout << "  " << per_run << " instructions retired per run, " << per_second << " per second" << std::endl;
+    else
+        std::cout << "  instructions retired: hardware counters unavailable" << std::endl;
+    if(BENCH_CSV.empty())
+        return median;
+    std::ifstream existing(BENCH_CSV);
+    const bool header = !existing || existing.peek() == std::ifstream::traits_type::eof();
+    existing.close();
+    std::ofstream csv(BENCH_CSV, std::ios::app);
+    if(header)
+        csv << "file,engine,runs,min_ms,median_ms,p99_ms,instructions,instructions_per_second" << std::endl;
+    csv << path << ',' << engine_name(ENGINE) << ',' << BENCH_RUNS << ',' << min << ',' << median << ',' << p99 << ',';
+    if(counter.available())
+        csv << per_run << ',' << per_second;
+    else
+        csv << ','; // Left empty without counters
+    csv << std::endl;
+    if(!csv)
+    {
+        std::cerr << "Could not write " << BENCH_CSV << std::endl;
+        exit(-1);
     }
-    return stream.str();
+    return median;
 }
 
-//Remove invalid characters from the raw source
-std::string switch_sanitize(const std::string & source)
+//The median milliseconds of each file and engine in a --bench-csv file, the last one where there are several
+static std::map<std::pair<std::string, std::string>, double> read_baseline(const std::string & path)
 {
-    std::ostringstream stream;
-    char ptr_specifier = 'A';
-    for(const char c : source)
-    {
-        switch(c){
-            case 'A':
-            case 'B': // FALLTHROUGH
-                ptr_specifier = c;
-                break;
-
-            case '<':
-            case '>': // FALLTHROUGH
-            case '-': // FALLTHROUGH
-            case '+': // FALLTHROUGH
-            case '.': // FALLTHROUGH
-            case ',': // FALLTHROUGH
-            case '[': // FALLTHROUGH
-            case ']': // FALLTHROUGH
-                stream << c << ptr_specifier;
-                break;
+    std::ifstream csv(path);
+    if(!csv)
+    {
+        std::cerr << "Could not read " << path << std::endl;
+        exit(-1);
+    }
+    std::map<std::pair<std::string, std::string>, double> medians;
+    std::string line;
+    std::getline(csv, line); // The header
+    while(std::getline(csv, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream row(line);
+        for(std::string field; std::getline(row, field, ',');)
+            fields.push_back(field);
+        if(fields.size() < 5)
+        {
+            std::cerr << "Malformed line in " << path << ": " << line << std::endl;
+            exit(-1);
         }
+        medians[std::make_pair(fields[0], fields[1])] = atof(fields[4].c_str());
     }
-    return stream.str();
+    return medians;
 }
 
-typedef std::stack<uint64_t> loop_stack;
+// The engines --differential runs programs on, the first of them being the one the others have to agree with
+static const Engine ENGINES[] = { Engine::CHARS, Engine::TOKENS, Engine::THREADED, Engine::JIT, Engine::TIERED };
+
+//Where a and b first differ, or std::string::npos if they don't
+static size_t first_difference(const std::string & a, const std::string & b)
+{
+    if(a == b)
+        return std::string::npos;
+    const size_t common = std::min(a.size(), b.size());
+    return std::mismatch(a.begin(), a.begin() + common, b.begin()).first - a.begin();
+}
 
-void tokenize(const std::string & source, std::vector<Instr> & out)
+//Run the program on every engine with the same input, and report where an engine's output or final tape differs
+//from the first engine's, which runs the source as it is, unoptimized. The others run the program without its
+//prefix, so that they take every step of the run the optimizer compiled. With --bench also time each engine, and report those that got slower than PERF_BASELINE
+//allows. Returns the exit status: -1 if any engine differed or got slower.
+static int differential(const std::string & path, const Program & program)
 {
-    loop_stack jump_stack;
-    assert(source.length() % 2 == 0); // source length MUST be even
-    for(uint64_t char_pos = 0; char_pos < source.length(); char_pos += 2)
+    std::map<std::pair<std::string, std::string>, double> baseline;
+    if(!PERF_BASELINE.empty())
+        baseline = read_baseline(PERF_BASELINE);
+    std::string reference_output;
+    std::string reference_tape;
+    int failed = 0;
+    const Program reference = compile(program.instructions, Dialect::TWO_CHAR, false, program.cell_bits);
+    const Program optimized = without_prefix(program);
+    Tape tape(tape_bytes(program), CHECKED);
+    for(const Engine engine : ENGINES)
     {
-        Instr ins;
-        switch(source[char_pos])
+        const Program & runs = engine == ENGINES[0] ? reference : optimized;
+        std::ostringstream output;
+        Engine ran;
+        FILE *input_file = open_fixed_input();
         {
-            case '<':
-                ins.type = InstrType::LEFT;
-                break;
-            case '>':
-                ins.type = InstrType::RIGHT;
-                break;
-            case '-':
-                ins.type = InstrType::MINUS;
-                break;
-            case '+':
-                ins.type = InstrType::PLUS;
-                break;
-            case '.':
-                ins.type = InstrType::OUTPUT;
-                break;
-            case ',':
-                ins.type = InstrType::INPUT;
-                break;
-            case '[':
-                ins.type = InstrType::LOOP_OPEN;
-                break;
-            case ']':
-                ins.type = InstrType::LOOP_CLOSE;
-                break;
+            InputSource in(input_file, false, EOF_MODE);
+            OutputSink out(output, true, false);
+            tape.reset();
+            try
+            {
+                ran = run(runs, tape, in, out, engine, LIMITS);
+            }
+            catch(const TapeError & error)
+            {
+                // Compared as the end of its output, for engines leaving the tape alike to agree
+                out.flush();
+                output << std::endl << error.what();
+                ran = Engine::TOKENS; // The only engine checked tapes run on
+            }
+            out.flush();
         }
-        switch(source[char_pos + 1])
+        fclose(input_file);
+        // Past the last nonzero byte the tapes agree either way, however far each of them was committed
+        std::string cells((const char *)tape.cells(), tape.used());
+        cells.erase(cells.find_last_not_of('\0') + 1);
+
+        std::cout << path << " on " << engine_name(engine);
+        if(ran != engine)
+            std::cout << " (on the tokens engine: " << fallback_reason(program, tape.checked()) << ")";
+        if(engine == ENGINES[0])
         {
-            case 'A':
-                ins.ptr = Ptr::A;
-                break;
-            case 'B':
-                ins.ptr = Ptr::B;
-                break;
+            reference_output = output.str();
+            reference_tape = cells;
+            std::cout << ": " << reference_output.size() << " bytes of output, " << program.eliminated
+                      << " dead tokens eliminated" << std::endl;
         }
-        out.push_back(ins);
-        if(ins.type == InstrType::LOOP_OPEN)
+        else
         {
-            jump_stack.push(char_pos / 2);
+            const size_t output_at = first_difference(reference_output, output.str());
+            const size_t tape_at = first_difference(reference_tape, cells);
+            if(output_at == std::string::npos && tape_at == std::string::npos)
+                std::cout << ": agrees with " << engine_name(ENGINES[0]) << std::endl;
+            else
+            {
+                std::cout << ": DIFFERS from " << engine_name(ENGINES[0]);
+                if(output_at != std::string::npos)
+                    std::cout << ", in its output from byte " << output_at;
+                if(tape_at != std::string::npos)
+                    std::cout << ", on its tape from cell " << tape_at / (program.cell_bits / 8);
+                std::cout << std::endl;
+                failed++;
+            }
         }
-        if(ins.type == InstrType::LOOP_CLOSE)
+        if(!BENCH_RUNS)
+            continue;
+        ENGINE = engine;
+        const double median = bench(path, runs);
+        const auto saved = baseline.find(std::make_pair(path, std::string(engine_name(engine))));
+        if(saved == baseline.end())
+            continue;
+        const double slower = saved->second > 0 ? (median / saved->second - 1) * 100 : 0;
+        if(slower > PERF_TOLERANCE && median - saved->second > PERF_NOISE_MS)
         {
-            uint64_t pos = jump_stack.top();
-            jump_stack.pop();
-            uint64_t jump_distance = char_pos / 2 - pos;
-            out.back().jump = jump_distance;
-            out.at(pos).jump = jump_distance;
+            std::cout << "  SLOWER by " << slower << "% than the baseline's median of " << saved->second << " ms" << std::endl;
+            failed++;
         }
+        else
+            std::cout << "  within " << PERF_TOLERANCE << "% or " << PERF_NOISE_MS << " ms of the baseline's median of "
+                      << saved->second << " ms" << std::endl;
+    }
+    return failed ? -1 : 0;
+}
+
+//s as a JSON string
+static std::string json_string(const std::string & s)
+{
+    std::string quoted = "\"";
+    for(const char c : s)
+    {
+        if(c == '"' || c == '\\')
+            quoted += std::string("\\") + c;
+        else if((unsigned char)c < 0x20)
+        {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        }
+        else
+            quoted += c;
+    }
+    return quoted + "\"";
+}
+
+//Run the program once while counting its hardware events, and the interpreter's own stats where the run is on the
+//tokens engine, then write them to PERF_STATS ("-" for stderr) as a JSON object. Counts that weren't available are null.
+//The format only ever gains fields, with "format" bumped when a field changes meaning. The whole run is counted,
+//without the prefix.
+static void run_with_stats(const std::string & path, const Program & compiled, Tape & tape, InputSource & in, OutputSink & out)
+{
+    const Program program = without_prefix(compiled);
+    static const std::pair<HardwareEvent, const char *> events[] = {
+        {HardwareEvent::CYCLES, "cycles"}, {HardwareEvent::INSTRUCTIONS, "instructions"},
+        {HardwareEvent::BRANCH_MISSES, "branch_misses"}, {HardwareEvent::L1D_READ_MISSES, "l1d_read_misses"}
+    };
+    std::vector<std::unique_ptr<HardwareCounter>> counters;
+    for(const auto & event : events)
+        counters.emplace_back(new HardwareCounter(event.first));
+    RunStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    for(auto & counter : counters)
+        counter->start();
+    const Engine ran = run_program(program, tape, in, out, &stats);
+    std::vector<uint64_t> counts;
+    for(auto & counter : counters)
+        counts.push_back(counter->stop());
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    out.flush();
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"format\": 1,\n"
+         << "  \"file\": " << json_string(path) << ",\n"
+         << "  \"engine\": \"" << engine_name(ran) << "\",\n"
+         << "  \"cell_bits\": " << program.cell_bits << ",\n"
+         << "  \"eliminated\": " << program.eliminated << ",\n"
+         << "  \"wall_ms\": " << milliseconds << ",\n"
+         << "  \"hardware\": {";
+    for(size_t index = 0; index < counters.size(); index++)
+    {
+        json << (index ? ", " : "") << "\"" << events[index].second << "\": ";
+        if(counters[index]->available())
+            json << counts[index];
+        else
+            json << "null";
+    }
+    json << "},\n"
+         << "  \"interpreter\": ";
+    if(stats.counted)
+        json << "{\"dispatched\": " << stats.dispatched
+             << ", \"loop_open\": {\"taken\": " << stats.open_taken << ", \"not_taken\": " << stats.open_not_taken << "}"
+             << ", \"loop_close\": {\"taken\": " << stats.close_taken << ", \"not_taken\": " << stats.close_not_taken << "}"
+             << ", \"high_water\": {\"A\": " << stats.high_water[0] << ", \"B\": " << stats.high_water[1] << "}}";
+    else
+        json << "null";
+    json << "\n}\n";
+
+    if(PERF_STATS == "-")
+    {
+        std::cerr << json.str();
+        return;
+    }
+    std::ofstream file(PERF_STATS);
+    file << json.str();
+    if(!file)
+    {
+        std::cerr << "Could not write " << PERF_STATS << std::endl;
+        exit(-1);
     }
 }
 
-//Interpret and execute the MM code.
-void execute(const char *instructions)
+//Run the program once while recording its trace to TRACE
+static void run_traced(const Program & program, Tape & tape, InputSource & in, OutputSink & out)
 {
-    const char *instruction_pointer;         //Keeps track of the interpreter's position in the program.
-    std::unique_ptr<uint8_t> data_tape;                //Stores the data used by the program. Basically, it's RAM.
-    uint8_t *data_pointer_A;           //Used to modify/read cells on the data_tape. Controllable.
-    uint8_t *data_pointer_B;           //Used to modify/read cells on the data_tape. Controllable.
+    std::ofstream file(TRACE, std::ios::binary);
+    if(file)
+        trace_program(program, tape, in, out, file);
+    if(!file)
+    {
+        out.flush();
+        std::cerr << "Could not write " << TRACE << std::endl;
+        exit(-1);
+    }
+}
 
+//The value of the given cell of the tape, as the program's cells are
+static std::string cell_value(const Program & program, const Tape & tape, int64_t cell)
+{
+    const uint64_t bytes = program.cell_bits / 8;
+    if(cell < 0 || (uint64_t)cell >= tape.size() / bytes)
+        return "off the tape";
+    const uint8_t *at = tape.cells() + cell * bytes;
+    switch(program.cell_bits)
+    {
+        case 16:
+            return std::to_string(*(const uint16_t *)at);
+        case 32:
+            return std::to_string(*(const uint32_t *)at);
+        default:
+            return std::to_string(*at);
+    }
+}
 
-    instruction_pointer = instructions;
-    data_tape = std::unique_ptr<uint8_t>(new uint8_t[30000]()); //BrainFuck interpreters conventionally have a 30000 byte memory block.
-    memset(data_tape.get(), 0, 30000); // Clearing the entire tape, just in case
-    data_pointer_A = data_tape.get();
-    data_pointer_B = data_tape.get();
+//Replay the run recorded in REPLAY, and where it stopped at SEEK, report where that is on stderr
+static void run_replay(const SourceFile & source, const Program & program, Tape & tape, OutputSink & out)
+{
+    SourceFile trace;
+    if(!trace.open(REPLAY))
+    {
+        std::cerr << "Could not read " << REPLAY << std::endl;
+        exit(-1);
+    }
+    ReplayStop stop;
+    try
+    {
+        stop = replay_program(program, trace.begin(), trace.end(), tape, out, SEEK);
+    }
+    catch(const SourceError & error)
+    {
+        stop_program(out, error, -1);
+    }
+    out.flush();
+    std::cout << std::flush;
+    if(SEEK == UINT64_MAX)
+        return;
+    if(stop.ended)
+    {
+        std::cerr << std::endl << "The run ended after " << stop.steps << " steps, before step " << SEEK << std::endl;
+        return;
+    }
+    std::cerr << std::endl << "Stopped after " << stop.steps << " steps, before token " << stop.token;
+    if(!is_saved_program(source.begin(), source.end())) // Whose positions are in a source that isn't here
+    {
+        const char *at = source.begin() + program.tokens[stop.token].position;
+        const char *line = at;
+        while(line != source.begin() && line[-1] != '\n')
+            line--;
+        std::cerr << " (" << std::count(source.begin(), line, '\n') + 1 << ":" << at - line + 1 << ")";
+    }
+    std::cerr << ": A on cell " << stop.a << " (" << cell_value(program, tape, stop.a) << "), B on cell " << stop.b
+              << " (" << cell_value(program, tape, stop.b) << ")" << std::endl;
+}
 
+//Write a saved program, through a temporary file so that nothing ever reads half of one
+static bool write_saved_program(const std::string & path, const Program & program, const ProgramKey & key)
+{
+    const std::string temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        save_program(program, key, out);
+        if(!out)
+            return false;
+    }
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+//The program in a source or saved program file, through the cache if there is one, and the key to save it by.
+//Throws a SourceError if the source is malformed.
+static Program load_or_compile(const SourceFile & source, Dialect dialect, ProgramKey & key)
+{
+    if(is_saved_program(source.begin(), source.end()))
+        return load_program(source.begin(), source.end(), key);
+    key.source_hash = hash_source(source.begin(), source.end());
+    key.dialect = dialect;
+    key.optimized = OPTIMIZE;
+    key.cell_bits = CELL_BITS;
+    if(CACHE_DIR.empty())
+        return compile(source.begin(), source.end(), dialect, OPTIMIZE, CELL_BITS);
 
-    while(*instruction_pointer) //Until the instruction pointer reaches the end of the instructions
+    char name[64];
+    snprintf(name, sizeof(name), "/%016llx%s%s%s.mmc", (unsigned long long)key.source_hash,
+             dialect == Dialect::SWITCH ? "-switch" : "", OPTIMIZE ? "" : "-raw",
+             CELL_BITS == 8 ? "" : CELL_BITS == 16 ? "-16" : "-32");
+    const std::string path = CACHE_DIR + name;
+    SourceFile cached;
+    if(cached.open(path))
     {
-        uint8_t **data_ptr; //Holds the address of the pointer specified by the command.
-        switch(*(instruction_pointer + 1))
+        try
         {
-            case 'A':
-                data_ptr = &data_pointer_A;
-                break;
-            case 'B':
-                data_ptr = &data_pointer_B;
-                break;
-            default:
-                assert(false); // Should never happen
+            ProgramKey cached_key;
+            Program program = load_program(cached.begin(), cached.end(), cached_key);
+            if(cached_key.source_hash == key.source_hash && cached_key.dialect == key.dialect && cached_key.optimized == key.optimized
+               && cached_key.cell_bits == key.cell_bits)
+                return program;
         }
-
-        //Execute the appropriate instruction, using the appropriate data_pointer.
-        switch(*instruction_pointer)
+        catch(const SourceError &)
         {
-            case '+':
-                (**data_ptr)++;
-                break;
-            case '-':
-                (**data_ptr)--;
-                break;
-            case '>':
-                (*data_ptr)++;
-                break;
-            case '<':
-                (*data_ptr)--;
-                break;
-            case '.':
-                std::cout << (char)+(**data_ptr);
-                break;
-            case ',':
-                **data_ptr = getch();
-                std::cout << (char)+(**data_ptr);
-                break;
-            case '[':
-                if(**data_ptr == 0){       //If the data_ptr is zero, skip to the matching close bracket
-                    int level = 1;
-                    while(level){
-                        instruction_pointer+=2;
-                        if (*instruction_pointer == '[') {
-                            level++;
-                        } else
-                        if (*instruction_pointer == ']') {
-                            level--;
-                        }
-                    }
-                }                           //If the data_ptr isn't zero, let the interpreter enter the loop.
-                break;
-            case ']':
-                if(**data_ptr != 0){       //If the data_ptr is not zero, jump back to the matching open bracket
-                    int level = 1;
-                    while(level){
-                        instruction_pointer-=2;
-                        if (*instruction_pointer == '[') {
-                            level--;
-                        } else
-                        if (*instruction_pointer == ']') {
-                            level++;
-                        }
-                    }
-                    instruction_pointer-=2;
-                }                           //If the data_ptr isn't zero, let the interpreter exit the loop.
-                break;
-            default:
-                assert(false); // Should never happen
+            // Saved by another version: compile it again
         }
-        instruction_pointer+=2;         //Move to the next instruction
     }
+    Program program = compile(source.begin(), source.end(), dialect, OPTIMIZE, CELL_BITS);
+    if(!write_saved_program(path, program, key))
+        std::cerr << "Could not write " << path << std::endl;
+    return program;
 }
 
-//Interpret and execute the MM code.
-void execute_tokens(const std::vector<Instr> & instructions)
+//Call job(0) to job(count - 1) on a thread per core. Each worker takes jobs from the front of its
+//own queue, and once that ran out steals from the back of the others' queues.
+template<typename Job>
+static void run_pool(uint64_t count, Job job)
 {
-    std::unique_ptr<uint8_t> data_tape;                //Stores the data used by the program. Basically, it's RAM.
-    uint8_t *data_pointer_A;           //Used to modify/read cells on the data_tape. Controllable.
-    uint8_t *data_pointer_B;           //Used to modify/read cells on the data_tape. Controllable.
-
-
-    data_tape = std::unique_ptr<uint8_t>(new uint8_t[30000]()); //BrainFuck interpreters conventionally have a 30000 byte memory block.
-    memset(data_tape.get(), 0, 30000); // Clearing the entire tape, just in case
-    data_pointer_A = data_tape.get();
-    data_pointer_B = data_tape.get();
+    const uint64_t workers = std::max<uint64_t>(1, std::min<uint64_t>(count, std::thread::hardware_concurrency()));
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<uint64_t> jobs;
+    };
+    std::vector<Queue> queues(workers);
+    for(uint64_t index = 0; index < count; index++)
+        queues[index * workers / count].jobs.push_back(index); // Neighbouring jobs start on the same worker
+    auto take = [&](uint64_t self, uint64_t & index)
+    {
+        for(uint64_t victim = 0; victim < workers; victim++)
+        {
+            Queue & queue = queues[(self + victim) % workers];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if(queue.jobs.empty())
+                continue;
+            if(victim == 0)
+            {
+                index = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+            else
+            {
+                index = queue.jobs.back();
+                queue.jobs.pop_back();
+            }
+            return true;
+        }
+        return false; // No job is ever queued once the workers started
+    };
+    std::vector<std::thread> threads;
+    for(uint64_t self = 0; self < workers; self++)
+    {
+        threads.emplace_back([&, self]()
+        {
+            uint64_t index;
+            while(take(self, index))
+                job(index);
+        });
+    }
+    for(std::thread & thread : threads)
+        thread.join();
+}
 
+//Run every job of the manifest in parallel, and return the exit status.
+//Each line of the manifest is a job: a source file, an input file (- for none) and an output file,
+//separated by whitespace. Empty lines and lines starting with # are skipped.
+//Sources are compiled once however many jobs run them, and every job gets its own checked tape, where a job
+//leaving it fails with a TapeError rather than ending the whole batch.
+//With SNAPSHOT, each source also runs up to its first input once, and its jobs start from there.
+static int run_batch(const std::string & manifest_path)
+{
+    struct Job { std::string source, input, output; };
+    struct Compiled { Program program; Snapshot snapshot; std::string error; };
+    struct Result { std::string error; Engine engine; double milliseconds; };
+    std::ifstream manifest(manifest_path);
+    if(!manifest)
+    {
+        std::cerr << "Could not read " << manifest_path << std::endl;
+        return -1;
+    }
+    std::vector<Job> jobs;
+    std::map<std::string, Compiled> compiled;
+    std::string line;
+    for(uint64_t line_number = 1; getline(manifest, line); line_number++)
+    {
+        std::istringstream fields(line);
+        Job job;
+        if(!(fields >> job.source) || job.source[0] == '#')
+            continue;
+        if(!(fields >> job.input >> job.output))
+        {
+            std::cerr << manifest_path << ", line " << line_number << ": expected a source, an input and an output" << std::endl;
+            return -1;
+        }
+        compiled[job.source];
+        jobs.push_back(job);
+    }
 
-    for(auto instruction_pointer = instructions.begin();
-            instruction_pointer != instructions.end();
-            instruction_pointer++)
+    std::vector<std::pair<const std::string, Compiled> *> sources;
+    for(auto & entry : compiled)
+        sources.push_back(&entry);
+    const Dialect dialect = SWITCH ? Dialect::SWITCH : Dialect::TWO_CHAR;
+    run_pool(sources.size(), [&](uint64_t index)
     {
-        const Instr * instr_ptr = instructions.data(); // debug
-        uint8_t **data_ptr; //Holds the address of the pointer specified by the command.
-        switch(instruction_pointer->ptr)
+        SourceFile source;
+        if(!source.open(sources[index]->first))
         {
-            case Ptr::A:
-                data_ptr = &data_pointer_A;
-                break;
-            case Ptr::B:
-                data_ptr = &data_pointer_B;
-                break;
-            default:
-                assert(false); // Should never happen
+            sources[index]->second.error = "Could not read " + sources[index]->first;
+            return;
         }
+        try
+        {
+            ProgramKey key;
+            sources[index]->second.program = load_or_compile(source, dialect, key);
+            if(SNAPSHOT)
+            {
+                const Program & program = sources[index]->second.program;
+                sources[index]->second.snapshot = snapshot_program(program, tape_bytes(program), true);
+            }
+        }
+        catch(const SourceError & error)
+        {
+            sources[index]->second.error = sources[index]->first + ": " + error.what();
+        }
+        catch(const TapeError & error) // Before its first input, so in every job
+        {
+            sources[index]->second.error = sources[index]->first + ": " + error.what();
+        }
+    });
 
-        //Execute the appropriate instruction, using the appropriate data_pointer.
-        switch(instruction_pointer->type)
+    // Every source is in there, and from here on the workers share it only through const lookups
+    const std::map<std::string, Compiled> & programs = compiled;
+    std::vector<Result> results(jobs.size());
+    const auto start = std::chrono::steady_clock::now();
+    run_pool(jobs.size(), [&](uint64_t index)
+    {
+        const Job & job = jobs[index];
+        Result & result = results[index];
+        const auto job_start = std::chrono::steady_clock::now();
+        const Compiled & program = programs.at(job.source);
+        if(!program.error.empty())
         {
-            case InstrType::PLUS:
-                (**data_ptr)++;
-                break;
-            case InstrType::MINUS:
-                (**data_ptr)--;
-                break;
-            case InstrType::RIGHT:
-                (*data_ptr)++;
-                break;
-            case InstrType::LEFT:
-                (*data_ptr)--;
-                break;
-            case InstrType::OUTPUT:
-                std::cout << (char)+(**data_ptr);
-                break;
-            case InstrType::INPUT:
-                **data_ptr = getch();
-                std::cout << (char)+(**data_ptr);
-                break;
-            case InstrType::LOOP_OPEN:
-                if(**data_ptr == 0)       //If the data_ptr is zero, skip to the matching close bracket
-                {
-                    assert(instruction_pointer->jump != 0);
-                    instruction_pointer = std::next(instruction_pointer, instruction_pointer->jump);
-                }
-                break;
-            case InstrType::LOOP_CLOSE:
-                if(**data_ptr != 0)       //If the data_ptr is not zero, jump back to the matching open bracket
+            result.error = program.error;
+            return;
+        }
+        FILE *input_file = job.input == "-" ? tmpfile() : fopen(job.input.c_str(), "rb");
+        if(!input_file)
+        {
+            result.error = "Could not read " + job.input;
+            return;
+        }
+        std::ofstream output(job.output, std::ios::binary);
+        {
+            InputSource in(input_file, false, EOF_MODE);
+            OutputSink out(output, true, false);
+            Tape tape(tape_bytes(program.program), true); // Which fails just the job that leaves it
+            try
+            {
+                if(SNAPSHOT)
                 {
-                    assert(instruction_pointer->jump != 0);
-                    instruction_pointer = std::prev(instruction_pointer, instruction_pointer->jump);
+                    resume(program.program, program.snapshot, tape, in, out);
+                    result.engine = Engine::TOKENS;
                 }
-                break;
-            default:
-                assert(false); // Should never happen
+                else
+                    result.engine = run(program.program, tape, in, out, ENGINE, LIMITS);
+            }
+            catch(const LimitExceeded & error)
+            {
+                result.error = error.what(); // The output file keeps what the job output until then
+            }
+            catch(const TapeError & error)
+            {
+                result.error = error.what();
+            }
+        }
+        fclose(input_file);
+        if(!output)
+            result.error = "Could not write " + job.output;
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job_start).count();
+    });
+    const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t failed = 0;
+    for(uint64_t index = 0; index < jobs.size(); index++)
+    {
+        const Result & result = results[index];
+        std::cout << jobs[index].source << " < " << jobs[index].input << " > " << jobs[index].output << ": ";
+        if(!result.error.empty())
+        {
+            std::cout << result.error << std::endl;
+            failed++;
+        }
+        else
+        {
+            std::cout << result.milliseconds << " ms";
+            if(result.engine != ENGINE)
+                std::cout << " (on the tokens engine: " << fallback_reason(programs.at(jobs[index].source).program, true) << ")";
+            std::cout << std::endl;
         }
     }
+    std::cout << jobs.size() << " jobs, " << failed << " failed, in " << elapsed << " ms" << std::endl;
+    return failed ? -1 : 0;
 }
 
+int main(int argc, char * argv[])
+{
+    std::string path;
+    for(int arg_pos = 1; arg_pos < argc; arg_pos++)
+    {
+        if(std::string(argv[arg_pos]) == "--switch")
+            SWITCH = true;
+        else if(std::string(argv[arg_pos]) == "--tokens")
+            ENGINE = Engine::TOKENS;
+        else if(std::string(argv[arg_pos]) == "--jit")
+            ENGINE = Engine::JIT;
+        else if(std::string(argv[arg_pos]).compare(0, 9, "--engine=") == 0)
+        {
+            std::string name = std::string(argv[arg_pos]).substr(9);
+            if(name == "chars")
+                ENGINE = Engine::CHARS;
+            else if(name == "tokens")
+                ENGINE = Engine::TOKENS;
+            else if(name == "threaded")
+                ENGINE = Engine::THREADED;
+            else if(name == "jit")
+                ENGINE = Engine::JIT;
+            else if(name == "tiered")
+                ENGINE = Engine::TIERED;
+            else
+            {
+                std::cerr << "Unknown engine " << name << " (expected chars, tokens, threaded, jit or tiered)" << std::endl;
+                exit(-1);
+            }
+        }
+        else if(std::string(argv[arg_pos]) == "--no-optimize")
+            OPTIMIZE = false;
+        else if(std::string(argv[arg_pos]) == "--unbuffered")
+            UNBUFFERED = true;
+        else if(std::string(argv[arg_pos]) == "--input" && arg_pos + 1 < argc)
+            INPUT_PATH = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]).compare(0, 6, "--eof=") == 0)
+        {
+            std::string mode = std::string(argv[arg_pos]).substr(6);
+            if(mode == "0")
+                EOF_MODE = InputSource::Eof::ZERO;
+            else if(mode == "255")
+                EOF_MODE = InputSource::Eof::MAX;
+            else if(mode == "unchanged")
+                EOF_MODE = InputSource::Eof::UNCHANGED;
+            else
+            {
+                std::cerr << "Unknown EOF convention " << mode << " (expected 0, 255 or unchanged)" << std::endl;
+                exit(-1);
+            }
+        }
+        else if(std::string(argv[arg_pos]) == "--emit-c" && arg_pos + 1 < argc)
+            EMIT_C = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--bench" && arg_pos + 1 < argc)
+        {
+            BENCH_RUNS = atoi(argv[++arg_pos]);
+            if(BENCH_RUNS <= 0)
+            {
+                std::cerr << "Invalid benchmark run count " << argv[arg_pos] << std::endl;
+                exit(-1);
+            }
+        }
+        else if(std::string(argv[arg_pos]) == "--bench-csv" && arg_pos + 1 < argc)
+            BENCH_CSV = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--differential")
+            DIFFERENTIAL = true;
+        else if(std::string(argv[arg_pos]) == "--perf-baseline" && arg_pos + 1 < argc)
+            PERF_BASELINE = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--perf-tolerance" && arg_pos + 1 < argc)
+        {
+            char *end = nullptr;
+            PERF_TOLERANCE = strtod(argv[++arg_pos], &end);
+            if(*end || !(PERF_TOLERANCE >= 0))
+            {
+                std::cerr << "Invalid --perf-tolerance " << argv[arg_pos] << " (expected a percentage)" << std::endl;
+                exit(-1);
+            }
+        }
+        else if(std::string(argv[arg_pos]) == "--profile" && arg_pos + 1 < argc)
+            PROFILE = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--perf-stats" && arg_pos + 1 < argc)
+            PERF_STATS = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--checked")
+            CHECKED = true;
+        else if(std::string(argv[arg_pos]) == "--batch" && arg_pos + 1 < argc)
+            BATCH = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--snapshot")
+            SNAPSHOT = true;
+        else if(std::string(argv[arg_pos]) == "--compile-only")
+            COMPILE_ONLY = true;
+        else if(std::string(argv[arg_pos]) == "-o" && arg_pos + 1 < argc)
+            OUTPUT_PATH = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--stream")
+            STREAM = true;
+        else if(std::string(argv[arg_pos]) == "--trace" && arg_pos + 1 < argc)
+            TRACE = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--replay" && arg_pos + 1 < argc)
+            REPLAY = argv[++arg_pos];
+        else if(std::string(argv[arg_pos]) == "--seek" && arg_pos + 1 < argc)
+        {
+            char *end = nullptr;
+            SEEK = isdigit((unsigned char)argv[++arg_pos][0]) ? strtoull(argv[arg_pos], &end, 10) : UINT64_MAX;
+            if(SEEK == UINT64_MAX || *end)
+            {
+                std::cerr << "Invalid --seek " << argv[arg_pos] << " (expected a step count)" << std::endl;
+                exit(-1);
+            }
+        }
+        else if(std::string(argv[arg_pos]) == "--cache" && arg_pos + 1 < argc)
+            CACHE_DIR = argv[++arg_pos];
+        else if((std::string(argv[arg_pos]) == "--max-steps" || std::string(argv[arg_pos]) == "--timeout") && arg_pos + 1 < argc)
+        {
+            const std::string flag = argv[arg_pos++];
+            char *end = nullptr;
+            const uint64_t limit = isdigit((unsigned char)argv[arg_pos][0]) ? strtoull(argv[arg_pos], &end, 10) : 0;
+            if(limit == 0 || *end)
+            {
+                std::cerr << "Invalid " << flag << " " << argv[arg_pos] << " (expected a positive number)" << std::endl;
+                exit(-1);
+            }
+            (flag == "--max-steps" ? LIMITS.max_steps : LIMITS.timeout_ms) = limit;
+        }
+        else if(std::string(argv[arg_pos]) == "--cell-bits" && arg_pos + 1 < argc)
+        {
+            const std::string bits = argv[++arg_pos];
+            if(bits != "8" && bits != "16" && bits != "32")
+            {
+                std::cerr << "Invalid cell width " << bits << " (expected 8, 16 or 32)" << std::endl;
+                exit(-1);
+            }
+            CELL_BITS = atoi(bits.c_str());
+        }
+        else if(std::string(argv[arg_pos]).compare(0, 12, "--tape-size=") == 0)
+        {
+            std::string size = std::string(argv[arg_pos]).substr(12);
+            const std::string units = "KMG";
+            char *suffix = nullptr;
+            TAPE_SIZE = isdigit((unsigned char)size[0]) ? strtoull(size.c_str(), &suffix, 10) : 0;
+            if(suffix && *suffix && suffix[1] == '\0' && units.find(*suffix) != std::string::npos)
+                TAPE_SIZE <<= 10 * (units.find(*suffix) + 1);
+            else if(suffix && *suffix)
+                TAPE_SIZE = 0;
+            if(TAPE_SIZE == 0)
+            {
+                std::cerr << "Invalid tape size " << size << " (expected a number of cells, optionally followed by K, M or G)" << std::endl;
+                exit(-1);
+            }
+        }
+        else
+            path = std::string(argv[arg_pos]);
+    }
+    if(COMPILE_ONLY && OUTPUT_PATH.empty())
+    {
+        std::cerr << "--compile-only needs -o FILE" << std::endl;
+        exit(-1);
+    }
+    if(STREAM && (!BATCH.empty() || COMPILE_ONLY || !EMIT_C.empty() || BENCH_RUNS || !PROFILE.empty()
+                  || LIMITS.max_steps || LIMITS.timeout_ms))
+    {
+        std::cerr << "--stream only runs a single source, without --batch, --compile-only, --emit-c, --bench, --profile or limits" << std::endl;
+        exit(-1);
+    }
+    if(!PERF_STATS.empty() && (!BATCH.empty() || BENCH_RUNS || !PROFILE.empty() || STREAM))
+    {
+        std::cerr << "--perf-stats counts a single run, without --batch, --bench, --profile or --stream" << std::endl;
+        exit(-1);
+    }
+    if((!TRACE.empty() || !REPLAY.empty())
+       && (!TRACE.empty() == !REPLAY.empty() || !BATCH.empty() || COMPILE_ONLY || !EMIT_C.empty() || BENCH_RUNS
+           || !PROFILE.empty() || !PERF_STATS.empty() || STREAM || LIMITS.max_steps || LIMITS.timeout_ms))
+    {
+        std::cerr << "--trace and --replay run a single program, one or the other, without --batch, --compile-only,"
+                  << " --emit-c, --bench, --profile, --perf-stats, --stream or limits" << std::endl;
+        exit(-1);
+    }
+    if(SNAPSHOT && (BATCH.empty() || LIMITS.max_steps || LIMITS.timeout_ms))
+    {
+        std::cerr << "--snapshot only applies to --batch, without limits" << std::endl;
+        exit(-1);
+    }
+    if(SEEK != UINT64_MAX && REPLAY.empty())
+    {
+        std::cerr << "--seek needs --replay" << std::endl;
+        exit(-1);
+    }
+    if(DIFFERENTIAL && (!BATCH.empty() || COMPILE_ONLY || !EMIT_C.empty() || !PROFILE.empty() || !PERF_STATS.empty()
+                        || STREAM || !TRACE.empty() || !REPLAY.empty() || LIMITS.max_steps || LIMITS.timeout_ms))
+    {
+        std::cerr << "--differential runs a single program on every engine, without --batch, --compile-only, --emit-c,"
+                  << " --profile, --perf-stats, --stream, --trace, --replay or limits" << std::endl;
+        exit(-1);
+    }
+    if(!PERF_BASELINE.empty() && (!DIFFERENTIAL || !BENCH_RUNS))
+    {
+        std::cerr << "--perf-baseline needs --differential and --bench" << std::endl;
+        exit(-1);
+    }
+    if(!BATCH.empty())
+        return run_batch(BATCH);
+    if(argc == 0)
+    {
+        std::cout << "Enter a path to a MindMeld source file: ";
+        getline(std::cin, path);
+    }
+    SourceFile source;
+    if(!source.open(path))
+    {
+        std::cerr << "Could not read " << path << std::endl;
+        std::cout << "Press any key to continue..." << std::endl;
+        getch();
+        exit(-1);
+    }
+    const Dialect dialect = SWITCH ? Dialect::SWITCH : Dialect::TWO_CHAR;
+    if(!PROFILE.empty())
+        ENGINE = Engine::TOKENS; // The profiler instruments the token engine
+    if(!PROFILE.empty() && is_saved_program(source.begin(), source.end()))
+    {
+        std::cerr << "--profile needs the source, to locate the tokens in" << std::endl;
+        exit(-1);
+    }
+    if(STREAM && is_saved_program(source.begin(), source.end()))
+    {
+        std::cerr << "--stream needs the source, to tokenize while it runs" << std::endl;
+        exit(-1);
+    }
+    Program program;
+    ProgramKey key;
+    program.cell_bits = CELL_BITS;
+    try
+    {
+        // Also reports malformed sources and unbalanced brackets for the chars engine, before anything runs
+        if(!STREAM)
+            program = load_or_compile(source, dialect, key);
+    }
+    catch(const SourceError & error)
+    {
+        std::cerr << error.what() << std::endl;
+        exit(-1);
+    }
+    if(COMPILE_ONLY)
+    {
+        if(!write_saved_program(OUTPUT_PATH, program, key))
+        {
+            std::cerr << "Could not write " << OUTPUT_PATH << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
+    if(!EMIT_C.empty())
+    {
+        std::ofstream out(EMIT_C);
+        emit_c(program.tokens, TAPE_SIZE, EOF_MODE, out, program.cell_bits);
+        if(!out)
+        {
+            std::cerr << "Could not write " << EMIT_C << std::endl;
+            exit(-1);
+        }
+        return 0;
+    }
+    if(DIFFERENTIAL)
+        return differential(path, program);
+    if(BENCH_RUNS)
+    {
+        bench(path, program);
+        return 0;
+    }
+    if(!STREAM) // Which would wait for the whole source to be sanitized
+        std::cout << program.instructions << std::endl; // The sanitized source, as every engine runs it
+    OutputSink out(std::cout, !UNBUFFERED, stdout_is_terminal());
+    FILE *input_file = stdin;
+    if(!INPUT_PATH.empty())
+    {
+        input_file = fopen(INPUT_PATH.c_str(), "rb");
+        if(!input_file)
+        {
+            std::cerr << "Could not read " << INPUT_PATH << std::endl;
+            exit(-1);
+        }
+    }
+    InputSource in(input_file, INPUT_PATH.empty() && stdin_is_terminal(), EOF_MODE);
+    Tape tape(tape_bytes(program), CHECKED);
+    try
+    {
+        if(STREAM)
+            run_streaming(source.begin(), source.end(), dialect, tape, in, out, CELL_BITS);
+        else if(!PROFILE.empty())
+        {
+            std::ofstream folded(PROFILE);
+            profile_tokens(program.tokens, source.begin(), source.end(), tape, in, out, std::cerr, folded, program.cell_bits);
+            if(!folded)
+            {
+                std::cerr << "Could not write " << PROFILE << std::endl;
+                exit(-1);
+            }
+        }
+        else if(!PERF_STATS.empty())
+            run_with_stats(path, program, tape, in, out);
+        else if(!TRACE.empty())
+            run_traced(program, tape, in, out);
+        else if(!REPLAY.empty())
+            run_replay(source, program, tape, out);
+        else
+            run_program(program, tape, in, out);
+    }
+    catch(const SourceError & error) // Of a streamed source, once the run reached it
+    {
+        stop_program(out, error, -1);
+    }
+    catch(const TapeError & error)
+    {
+        stop_program(out, error, -1);
+    }
+    out.flush();
+    if(input_file != stdin)
+        fclose(input_file);
+    std::cout << std::endl << "Press any key to continue..." << std::endl;
+    getch();
+    return 0;
+}
@@ -0,0 +1,4281 @@
+#include "mindmeld.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <stack>
+#include <thread>
+#include <utility>
+#ifdef _WIN32
+#include <conio.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef __unix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "getch.hpp"
+#endif
+// The JIT emits x86-64 or AArch64 code into an mmap'd buffer
+#if defined(__unix) && (defined(__x86_64__) || (defined(__aarch64__) && !defined(__APPLE__)))
+#define JIT_SUPPORTED 1
+#endif
+
+//Execute an input instruction on cell
+template<typename Cell>
+static inline void read_input(InputSource & in, OutputSink & out, Cell & cell)
+{
+    if(in.echoes())
+    {
+        out.flush(); // Show any prompt before waiting on the user
+        in.get(cell);
+        out.put(cell);
+    }
+    else
+    {
+        in.get(cell);
+    }
+}
+
+// Why a program was stopped for leaving the tape
+static const char *const TAPE_LEFT_ERROR = "Data pointer moved left of the first cell of the tape";
+static const char *const TAPE_RIGHT_ERROR = "Data pointer moved past the last cell of the tape, try a larger --tape-size";
+
+SourceFile::~SourceFile()
+{
+#ifdef __unix
+    if(mapped)
+        munmap((void *)data, length);
+#endif
+}
+
+//Map the given file into memory, or read it into a buffer where mapping isn't available
+bool SourceFile::open(const std::string & filename)
+{
+#ifdef __unix
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+    {
+        length = info.st_size;
+        void *mapping = length ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        if(mapping != MAP_FAILED)
+        {
+            madvise(mapping, length, MADV_SEQUENTIAL); // The file is read from start to end exactly once
+            data = (const char *)mapping;
+            mapped = true;
+            close(fd);
+            return true;
+        }
+    }
+    close(fd);
+#endif
+    std::ifstream source(filename, std::ios::binary);
+    if(!source)
+        return false;
+    contents.assign(std::istreambuf_iterator<char>(source), std::istreambuf_iterator<char>());
+    data = contents.data();
+    length = contents.size();
+    return true;
+}
+
+//Report an error in the source at the given position
+[[noreturn]] static void source_error(const char *begin, const char *at, const std::string & message)
+{
+    uint64_t line = 1;
+    const char *line_start = begin;
+    for(const char *c = begin; c < at; c++)
+    {
+        if(*c == '\n')
+        {
+            line++;
+            line_start = c + 1;
+        }
+    }
+    throw SourceError("Line " + std::to_string(line) + ", column " + std::to_string((at - line_start) + 1) + ": " + message);
+}
+
+//The position of the lowest bit set in value, which isn't zero
+static unsigned lowest_bit(uint64_t value)
+{
+    assert(value != 0);
+#if defined(__GNUC__)
+    return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    unsigned index = 0;
+    for(; !(value & 1); value >>= 1)
+        index++;
+    return index;
+#endif
+}
+
+// The sanitizer's state machine, fed the characters of the raw source in order.
+// Characters other than instructions and pointers can be skipped, they are ignored anyway.
+template<typename Emit>
+struct SourceScanner
+{
+    Dialect dialect;
+    Emit & emit;
+    bool lastWasAB = false;
+    char ptr_specifier = 'A'; // The switch dialect's current pointer
+
+    SourceScanner(Dialect dialect, Emit & emit) : dialect(dialect), emit(emit) {}
+
+    void feed(const char *c)
+    {
+        switch(*c){
+            case 'A':
+            case 'B': // FALLTHROUGH
+                if(dialect == Dialect::SWITCH)
+                {
+                    ptr_specifier = *c;
+                    break;
+                }
+                if(lastWasAB)
+                    break;
+                lastWasAB = true;
+                emit(*c, c);
+                break;
+
+            case '<':
+            case '>': // FALLTHROUGH
+            case '-': // FALLTHROUGH
+            case '+': // FALLTHROUGH
+            case '.': // FALLTHROUGH
+            case ',': // FALLTHROUGH
+            case '[': // FALLTHROUGH
+            case ']': // FALLTHROUGH
+                lastWasAB = false;
+                emit(*c, c);
+                if(dialect == Dialect::SWITCH)
+                    emit(ptr_specifier, c);
+                break;
+        }
+    }
+
+    //Feed the characters of block whose bits are set in mask, which has bits_per_char bits for each character
+    void feed_mask(const char *block, uint64_t mask, int bits_per_char)
+    {
+        while(mask)
+        {
+            feed(block + lowest_bit(mask) / bits_per_char);
+            mask &= mask - 1;
+        }
+    }
+};
+
+// Vector kernels find the instruction and pointer characters of a whole block at once.
+// Bytes are classified with two 16-entry tables indexed by their low and high nibbles:
+// a byte is significant if both entries share a bit. Bit 0 covers + , - . (0x2B-0x2E),
+// bit 1 < > (0x3C, 0x3E), bit 2 A B (0x41, 0x42), and bit 3 [ ] (0x5B, 0x5D).
+#define SCAN_LOW_NIBBLES  0, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 9, 3, 9, 3, 0
+#define SCAN_HIGH_NIBBLES 0, 0, 1, 2, 4, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SCAN_SSE2 1
+#define SCAN_AVX2 1
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef SCAN_SSE2
+//SSE2 has no byte shuffle, so compare the 16 bytes against every significant character
+template<typename Emit>
+static void scan_sse2(const char *& c, const char *end, SourceScanner<Emit> & scanner)
+{
+    for(; end - c >= 16; c += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i *)c);
+        // + , - . are contiguous, test them as one range
+        const __m128i punctuation = _mm_cmplt_epi8(_mm_sub_epi8(bytes, _mm_set1_epi8(0x2b - 128)),
+                                                   _mm_set1_epi8(4 - 128));
+        __m128i found = punctuation;
+        for(const char target : {'<', '>', 'A', 'B', '[', ']'})
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(target)));
+        scanner.feed_mask(c, (uint32_t)_mm_movemask_epi8(found), 1);
+    }
+}
+#endif
+
+#ifdef SCAN_AVX2
+__attribute__((target("avx2"))) static inline uint32_t classify_avx2(const char *c)
+{
+    const __m256i low_table = _mm256_setr_epi8(SCAN_LOW_NIBBLES, SCAN_LOW_NIBBLES);
+    const __m256i high_table = _mm256_setr_epi8(SCAN_HIGH_NIBBLES, SCAN_HIGH_NIBBLES);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i bytes = _mm256_loadu_si256((const __m256i *)c);
+    const __m256i low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(bytes, nibble));
+    const __m256i high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+    const __m256i ignored = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256());
+    return ~(uint32_t)_mm256_movemask_epi8(ignored);
+}
+
+template<typename Emit>
+__attribute__((target("avx2"))) static void scan_avx2(const char *& c, const char *end, SourceScanner<Emit> & scanner)
+{
+    for(; end - c >= 32; c += 32)
+        scanner.feed_mask(c, classify_avx2(c), 1);
+}
+#endif
+
+#ifdef SCAN_NEON
+template<typename Emit>
+static void scan_neon(const char *& c, const char *end, SourceScanner<Emit> & scanner)
+{
+    static const uint8_t low_nibbles[16] = { SCAN_LOW_NIBBLES };
+    static const uint8_t high_nibbles[16] = { SCAN_HIGH_NIBBLES };
+    const uint8x16_t low_table = vld1q_u8(low_nibbles);
+    const uint8x16_t high_table = vld1q_u8(high_nibbles);
+    for(; end - c >= 16; c += 16)
+    {
+        const uint8x16_t bytes = vld1q_u8((const uint8_t *)c);
+        const uint8x16_t low = vqtbl1q_u8(low_table, vandq_u8(bytes, vdupq_n_u8(0x0f)));
+        const uint8x16_t high = vqtbl1q_u8(high_table, vshrq_n_u8(bytes, 4));
+        const uint8x16_t found = vtstq_u8(low, high);
+        // NEON has no movemask, narrowing leaves 4 bits per byte instead
+        const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(found), 4)), 0);
+        scanner.feed_mask(c, mask & 0x8888888888888888ull, 4);
+    }
+}
+#endif
+
+//Whether the CPU running us supports AVX2, checked once
+static bool cpu_has_avx2()
+{
+#ifdef SCAN_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+//Feed emit every character the sanitizer keeps from the raw source, with its position.
+//In the switch dialect, each instruction is followed by the pointer it applies to.
+template<typename Emit>
+static void scan_source(const char *begin, const char *end, Dialect dialect, Emit emit)
+{
+    SourceScanner<Emit> scanner(dialect, emit);
+    const char *c = begin;
+#if defined(SCAN_AVX2)
+    if(cpu_has_avx2())
+        scan_avx2(c, end, scanner);
+    else
+        scan_sse2(c, end, scanner);
+#elif defined(SCAN_NEON)
+    scan_neon(c, end, scanner);
+#endif
+    for(; c != end; c++) // What the vector kernels left over
+        scanner.feed(c);
+}
+
+//Remove invalid characters from the raw source
+std::string source_sanitize(const char *begin, const char *end)
+{
+    std::string instructions;
+    scan_source(begin, end, Dialect::TWO_CHAR, [&](char c, const char *) { instructions += c; });
+    return instructions;
+}
+
+//Remove invalid characters from the raw source, writing out the pointer of every instruction
+std::string switch_sanitize(const char *begin, const char *end)
+{
+    std::string instructions;
+    scan_source(begin, end, Dialect::SWITCH, [&](char c, const char *) { instructions += c; });
+    return instructions;
+}
+
+//The instruction type an instruction character stands for
+static bool decode_type(char c, InstrType & type)
+{
+    switch(c)
+    {
+        case '<':
+            type = InstrType::LEFT;
+            return true;
+        case '>':
+            type = InstrType::RIGHT;
+            return true;
+        case '-':
+            type = InstrType::MINUS;
+            return true;
+        case '+':
+            type = InstrType::PLUS;
+            return true;
+        case '.':
+            type = InstrType::OUTPUT;
+            return true;
+        case ',':
+            type = InstrType::INPUT;
+            return true;
+        case '[':
+            type = InstrType::LOOP_OPEN;
+            return true;
+        case ']':
+            type = InstrType::LOOP_CLOSE;
+            return true;
+        default:
+            return false;
+    }
+}
+
+typedef std::stack<uint64_t> loop_stack;
+
+//Sanitize the raw source, and call token(ins, at) for each of its instructions in order, with the type,
+//pointer and position of ins set, and at the instruction character in the source. Loops are left unlinked.
+template<typename Token>
+static void scan_tokens(const char *begin, const char *end, Dialect dialect, Token token)
+{
+    Instr ins;
+    bool have_type = false;
+    const char *type_position = begin;
+    scan_source(begin, end, dialect, [&](char c, const char *at)
+    {
+        if(!have_type)
+        {
+            if(!decode_type(c, ins.type))
+                source_error(begin, at, std::string("Expected an instruction before pointer ") + c);
+            have_type = true;
+            type_position = at;
+            return;
+        }
+        if(c != 'A' && c != 'B')
+            source_error(begin, type_position, std::string("Expected A or B after ") + source_character(ins.type));
+        have_type = false;
+        ins.ptr = c == 'A' ? Ptr::A : Ptr::B;
+        ins.jump = 0;
+        ins.position = type_position - begin;
+        token(ins, type_position);
+    });
+    if(have_type)
+        source_error(begin, type_position, std::string("Expected A or B after ") + source_character(ins.type));
+}
+
+//Sanitize and tokenize the raw source in a single pass
+void tokenize_source(const char *begin, const char *end, Dialect dialect, std::vector<Instr> & out)
+{
+    loop_stack jump_stack;
+    std::stack<const char *> open_positions; // For reporting unclosed loops
+    scan_tokens(begin, end, dialect, [&](const Instr & ins, const char *at)
+    {
+        out.push_back(ins);
+        if(ins.type == InstrType::LOOP_OPEN)
+        {
+            jump_stack.push(out.size() - 1);
+            open_positions.push(at);
+        }
+        if(ins.type == InstrType::LOOP_CLOSE)
+        {
+            if(jump_stack.empty())
+                source_error(begin, at, "Unmatched ]");
+            uint64_t pos = jump_stack.top();
+            jump_stack.pop();
+            open_positions.pop();
+            uint64_t jump_distance = out.size() - 1 - pos;
+            out.back().jump = jump_distance;
+            out.at(pos).jump = jump_distance;
+        }
+    });
+    if(!jump_stack.empty())
+        source_error(begin, open_positions.top(), "Unclosed [");
+}
+
+//Tokenize sanitized instructions
+void tokenize(const std::string & source, std::vector<Instr> & out)
+{
+    // Sanitizing again changes nothing, a sanitized source only holds instructions and pointers
+    tokenize_source(source.data(), source.data() + source.size(), Dialect::TWO_CHAR, out);
+}
+
+//The character of one of the tokenizer's instruction types
+char source_character(InstrType type)
+{
+    switch(type)
+    {
+        case InstrType::LEFT:
+            return '<';
+        case InstrType::RIGHT:
+            return '>';
+        case InstrType::MINUS:
+            return '-';
+        case InstrType::PLUS:
+            return '+';
+        case InstrType::OUTPUT:
+            return '.';
+        case InstrType::INPUT:
+            return ',';
+        case InstrType::LOOP_OPEN:
+            return '[';
+        case InstrType::LOOP_CLOSE:
+            return ']';
+        default:
+            return '?'; // Only produced by the optimizer
+    }
+}
+
+//Print the tokens as sanitized source, the way the character stream engine sees it
+void print_listing(const std::vector<Instr> & tokens, std::ostream & out)
+{
+    std::string chunk;
+    chunk.reserve(1 << 16);
+    for(const Instr & ins : tokens)
+    {
+        chunk += source_character(ins.type);
+        chunk += ins.ptr == Ptr::A ? 'A' : 'B';
+        if(chunk.size() >= (1 << 16))
+        {
+            out << chunk;
+            chunk.clear();
+        }
+    }
+    out << chunk << std::endl;
+}
+
+OutputSink::OutputSink(std::ostream & stream, bool buffered, bool line_buffered)
+    : stream(stream), buffered(buffered), line_buffered(line_buffered)
+{
+}
+
+OutputSink::~OutputSink()
+{
+    flush();
+}
+
+void OutputSink::put(uint8_t c, uint64_t count)
+{
+    if(!buffered || (line_buffered && c == '\n'))
+    {
+        for(uint64_t i = 0; i < count; i++)
+            put(c);
+        return;
+    }
+    while(count)
+    {
+        uint64_t chunk = std::min(count, (uint64_t)sizeof(buffer) - used);
+        memset(buffer + used, c, chunk);
+        used += chunk;
+        count -= chunk;
+        if(used == sizeof(buffer))
+            flush();
+    }
+}
+
+void OutputSink::write(const char *data, size_t size)
+{
+    if(buffered && used + size <= sizeof(buffer))
+    {
+        memcpy(buffer + used, data, size);
+        used += size;
+        if(used == sizeof(buffer) || (line_buffered && memchr(data, '\n', size)))
+            flush();
+        return;
+    }
+    // More than the buffer has room for: write out the buffer, then the bytes in a single write
+    flush();
+    stream.write(data, size);
+    if(line_buffered)
+        stream.flush();
+}
+
+//Write out everything output so far
+void OutputSink::flush()
+{
+    if(used)
+        stream.write(buffer, used);
+    used = 0;
+    stream.flush();
+}
+
+// The inaccessible bytes reserved on either side of a tape. Moves are folded, so a pointer can jump well past
+// the edge before it touches a cell.
+static const uint64_t TAPE_GUARD = sizeof(void *) == 8 ? (uint64_t)1 << 30 : (uint64_t)1 << 20;
+
+#ifdef __unix
+thread_local Tape *Tape::current = nullptr;
+static const uint64_t TAPE_FIRST_COMMIT = 1 << 16; // Accessible bytes of a new tape, before any fault grows it
+
+//Report a pointer leaving the tape. Called from the fault handler, so only async-signal-safe calls.
+static void tape_error(const char *message)
+{
+    ssize_t written = write(STDERR_FILENO, "\n", 1);
+    written = write(STDERR_FILENO, message, strlen(message));
+    written = write(STDERR_FILENO, "\n", 1);
+    (void)written; // Nothing left to do if even this fails
+    _exit(-1);
+}
+
+//Make the pages the pointers reach accessible, and stop the program when they leave the tape
+void Tape::on_fault(int signal, siginfo_t *info, void *)
+{
+    Tape *tape = current;
+    uint8_t *address = (uint8_t *)info->si_addr;
+    if(tape && address >= tape->reserved && address < tape->reserved + tape->reserved_length)
+    {
+        if(address < tape->data)
+            tape_error(TAPE_LEFT_ERROR);
+        if(address >= tape->data + tape->length)
+            tape_error(TAPE_RIGHT_ERROR);
+        if(address >= tape->data + tape->committed)
+        {
+            // Grow geometrically, so a pointer sweeping the tape faults only a few times
+            uint64_t needed = (address - tape->data + 0x10000) & ~(uint64_t)0xffff;
+            uint64_t grown = std::min(tape->length, std::max(tape->committed * 2, needed));
+            if(mprotect(tape->data + tape->committed, grown - tape->committed, PROT_READ | PROT_WRITE) == 0)
+            {
+                tape->committed = grown;
+                return; // Retry the access
+            }
+        }
+    }
+    ::signal(signal, SIG_DFL); // Not a tape access, crash as usual
+}
+#endif
+
+Tape::Tape(uint64_t size, bool checked) : checking(checked)
+{
+#ifdef __unix
+    const uint64_t page = sysconf(_SC_PAGESIZE);
+    length = (size + page - 1) / page * page;
+    reserved_length = TAPE_GUARD + length + TAPE_GUARD;
+    void *region = mmap(nullptr, reserved_length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(region != MAP_FAILED)
+    {
+        reserved = (uint8_t *)region;
+        data = reserved + TAPE_GUARD;
+        committed = std::min(length, TAPE_FIRST_COMMIT);
+        if(mprotect(data, committed, PROT_READ | PROT_WRITE) == 0)
+        {
+            static const bool installed = []()
+            {
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_sigaction = on_fault;
+                action.sa_flags = SA_SIGINFO;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGSEGV, &action, nullptr);
+                sigaction(SIGBUS, &action, nullptr); // What some systems raise for PROT_NONE pages
+                return true;
+            }();
+            (void)installed;
+            current = this;
+            return;
+        }
+        munmap(reserved, reserved_length);
+        reserved = nullptr;
+        reserved_length = 0;
+        committed = 0;
+    }
+#endif
+    length = size;
+    allocated.reset(new uint8_t[length]()); // Zeroed, but without any guard
+    data = allocated.get();
+}
+
+//Zero every cell again. Memory the pointers reached past the first cells is given back,
+//and faults on this thread are checked against this tape again.
+void Tape::reset()
+{
+#ifdef __unix
+    if(reserved)
+    {
+        const uint64_t first = std::min(length, TAPE_FIRST_COMMIT);
+        memset(data, 0, first);
+        if(committed > first)
+        {
+            // Fresh inaccessible pages read as zero once they are made accessible again
+            if(mmap(data + first, committed - first, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) != MAP_FAILED)
+                committed = first;
+            else
+                memset(data + first, 0, committed - first);
+        }
+        current = this;
+        return;
+    }
+#endif
+    memset(data, 0, length);
+}
+
+Tape::~Tape()
+{
+#ifdef __unix
+    if(reserved)
+    {
+        if(current == this)
+            current = nullptr;
+        munmap(reserved, reserved_length);
+    }
+#endif
+}
+
+//Map the image over the first bytes, for the tape to share the image's pages until it writes to them, or copy them
+void Tape::load(const TapeImage & image)
+{
+    assert(image.length <= length);
+#ifdef __linux__
+    if(reserved && image.file >= 0 && image.length % sysconf(_SC_PAGESIZE) == 0
+       && mmap(data, image.length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, image.file, 0) != MAP_FAILED)
+    {
+        committed = std::max(committed, image.length);
+        return;
+    }
+#endif
+    std::copy(image.view, image.view + image.length, data); // Faults in what isn't committed yet
+}
+
+TapeImage::TapeImage(const Tape & tape) : TapeImage(tape.cells(), tape.used())
+{
+}
+
+TapeImage::TapeImage(const uint8_t *bytes, uint64_t length) : length(length)
+{
+#ifdef __linux__
+    file = length ? memfd_create("mindmeld-tape", MFD_CLOEXEC) : -1;
+    if(file >= 0 && ftruncate(file, length) == 0)
+    {
+        void *mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if(mapped != MAP_FAILED)
+        {
+            std::copy(bytes, bytes + length, (uint8_t *)mapped);
+            view = (const uint8_t *)mapped;
+            return;
+        }
+    }
+    if(file >= 0)
+        close(file);
+    file = -1;
+#endif
+    copy.assign(bytes, bytes + length);
+    view = copy.data();
+}
+
+TapeImage::~TapeImage()
+{
+#ifdef __linux__
+    if(file >= 0)
+    {
+        munmap((void *)view, length);
+        close(file);
+    }
+#endif
+}
+
+InputSource::InputSource(FILE *file, bool console, Eof eof)
+    : file(file), console(console), eof(eof)
+{
+}
+
+//Store the next byte in cell once the buffer ran out
+template<typename Cell>
+void InputSource::refill(Cell & cell)
+{
+    if(console)
+    {
+        cell = getch();
+        return;
+    }
+    size_t count = fread(buffer, 1, sizeof(buffer), file);
+    if(count == 0)
+    {
+        if(eof == Eof::ZERO)
+            cell = 0;
+        else if(eof == Eof::MAX)
+            cell = (Cell)-1;
+        return;
+    }
+    next = buffer;
+    end = buffer + count;
+    cell = *next++;
+}
+
+//Run every optimization pass over the tokens, and return how many tokens eliminate_dead_code() removed
+template<typename Cell>
+uint64_t optimize(std::vector<Instr> & tokens)
+{
+    fold_runs<Cell>(tokens);
+    link_loops(tokens);
+    recognize_idioms<Cell>(tokens);
+    const uint64_t eliminated = eliminate_dead_code<Cell>(tokens);
+    fold_offsets(tokens); // Last, since the other passes ignore offsets
+    link_loops(tokens);
+    return eliminated;
+}
+
+//Collapse runs of PLUS/MINUS (resp. LEFT/RIGHT, OUTPUT) on the same pointer into a single ADD
+//(resp. MOVE, CONSECUTIVE_OUTPUT)
+template<typename Cell>
+void fold_runs(std::vector<Instr> & tokens)
+{
+    std::vector<Instr> out;
+    out.reserve(tokens.size());
+    for(auto it = tokens.begin(); it != tokens.end();)
+    {
+        bool is_add;
+        switch(it->type)
+        {
+            case InstrType::PLUS:
+            case InstrType::MINUS: // FALLTHROUGH
+            case InstrType::ADD: // FALLTHROUGH
+                is_add = true;
+                break;
+            case InstrType::LEFT:
+            case InstrType::RIGHT: // FALLTHROUGH
+            case InstrType::MOVE: // FALLTHROUGH
+                is_add = false;
+                break;
+            case InstrType::OUTPUT:
+            case InstrType::CONSECUTIVE_OUTPUT: // FALLTHROUGH
+            {
+                const Ptr ptr = it->ptr;
+                uint64_t count = 0;
+                auto run_end = it;
+                for(; run_end != tokens.end() && run_end->ptr == ptr; run_end++)
+                {
+                    if(run_end->type == InstrType::OUTPUT)
+                        count++;
+                    else if(run_end->type == InstrType::CONSECUTIVE_OUTPUT)
+                        count += run_end->jump;
+                    else
+                        break;
+                }
+                if(std::distance(it, run_end) == 1)
+                {
+                    out.push_back(*it);
+                }
+                else
+                {
+                    Instr ins;
+                    ins.type = InstrType::CONSECUTIVE_OUTPUT;
+                    ins.ptr = ptr;
+                    ins.jump = count;
+                    ins.position = it->position;
+                    out.push_back(ins);
+                }
+                it = run_end;
+                continue;
+            }
+            default:
+                out.push_back(*it++);
+                continue;
+        }
+
+        // Sum the run, wrapping around like the cells do
+        const Ptr ptr = it->ptr;
+        uint64_t amount = 0;
+        auto run_end = it;
+        for(; run_end != tokens.end() && run_end->ptr == ptr; run_end++)
+        {
+            if(is_add && run_end->type == InstrType::PLUS)
+                amount++;
+            else if(is_add && run_end->type == InstrType::MINUS)
+                amount--;
+            else if(!is_add && run_end->type == InstrType::RIGHT)
+                amount++;
+            else if(!is_add && run_end->type == InstrType::LEFT)
+                amount--;
+            else if(run_end->type == (is_add ? InstrType::ADD : InstrType::MOVE))
+                amount += run_end->jump;
+            else
+                break;
+        }
+        if(is_add)
+            amount = (Cell)amount; // Modulo the cells' width
+
+        if(std::distance(it, run_end) == 1)
+        {
+            out.push_back(*it);
+        }
+        else if(amount != 0) // A run that cancels out is dropped entirely
+        {
+            Instr ins;
+            ins.type = is_add ? InstrType::ADD : InstrType::MOVE;
+            ins.ptr = ptr;
+            ins.jump = amount;
+            ins.position = it->position;
+            out.push_back(ins);
+        }
+        it = run_end;
+    }
+    tokens.swap(out);
+}
+
+//For every loop, whether an iteration leaves the distance between A and B unchanged
+static std::vector<bool> loops_keeping_distance(const std::vector<Instr> & tokens)
+{
+    std::vector<bool> keeps(tokens.size(), false);
+    struct Frame { uint64_t open; int64_t moved_A; int64_t moved_B; bool keeps; };
+    std::stack<Frame> frames;
+    frames.push(Frame{0, 0, 0, true}); // The top level, never looked at
+    for(uint64_t pos = 0; pos < tokens.size(); pos++)
+    {
+        const Instr & ins = tokens[pos];
+        int64_t & moved = ins.ptr == Ptr::A ? frames.top().moved_A : frames.top().moved_B;
+        switch(ins.type)
+        {
+            case InstrType::RIGHT:
+                moved++;
+                break;
+            case InstrType::LEFT:
+                moved--;
+                break;
+            case InstrType::MOVE:
+                moved += (int64_t)ins.jump;
+                break;
+            case InstrType::LOOP_OPEN:
+                frames.push(Frame{pos, 0, 0, true});
+                break;
+            case InstrType::LOOP_CLOSE:
+            {
+                Frame loop = frames.top();
+                frames.pop();
+                bool loop_keeps = loop.keeps && loop.moved_A == loop.moved_B;
+                keeps[loop.open] = loop_keeps;
+                frames.top().keeps = frames.top().keeps && loop_keeps;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return keeps;
+}
+
+// The furthest an optimized instruction reaches from its pointer, well within the guards around the tape
+const int64_t MAX_FOLDED_OFFSET = 1 << 16;
+
+//Try to turn the balanced, I/O-free loop starting at open into SET_ZERO/MUL_ADD instructions.
+//distance is A's position minus B's position at the loop entry, if known.
+template<typename Cell>
+static bool rewrite_idiom(const std::vector<Instr> & tokens, uint64_t open,
+                          bool distance_known, int64_t distance, std::vector<Instr> & out)
+{
+    const uint64_t close = open + tokens[open].jump;
+
+    // Cells are identified by their position relative to A at the loop entry.
+    // B's cells can only be placed in that frame if the distance between A and B is known.
+    struct Change { Ptr ptr; int64_t offset; Cell amount; }; // Amounts wrap around like the cells do
+    std::map<int64_t, Change> changes;
+    int64_t pos_A = 0;
+    int64_t pos_B = 0;
+    bool uses_A = false;
+    bool uses_B = false;
+    for(uint64_t pos = open; pos <= close; pos++)
+    {
+        const Instr & ins = tokens[pos];
+        (ins.ptr == Ptr::A ? uses_A : uses_B) = true;
+        int64_t & ptr_pos = ins.ptr == Ptr::A ? pos_A : pos_B;
+        Cell amount;
+        switch(ins.type)
+        {
+            case InstrType::PLUS:
+                amount = 1;
+                break;
+            case InstrType::MINUS:
+                amount = -1;
+                break;
+            case InstrType::ADD:
+                amount = ins.jump;
+                break;
+            case InstrType::RIGHT:
+                ptr_pos++;
+                continue;
+            case InstrType::LEFT:
+                ptr_pos--;
+                continue;
+            case InstrType::MOVE:
+                ptr_pos += (int64_t)ins.jump;
+                continue;
+            case InstrType::LOOP_OPEN:
+            case InstrType::LOOP_CLOSE: // FALLTHROUGH
+                if(pos == open || pos == close)
+                    continue;
+                return false; // Nested loop
+            default:
+                return false; // I/O, or an already rewritten loop
+        }
+        int64_t cell = ins.ptr == Ptr::A ? ptr_pos : ptr_pos - distance;
+        auto found = changes.find(cell);
+        if(found == changes.end())
+            changes[cell] = Change{ins.ptr, ptr_pos, amount};
+        else
+            found->second.amount += amount;
+    }
+    if(pos_A != 0 || pos_B != 0)
+        return false; // The cells would be different on the next iteration
+    if(uses_A && uses_B && !distance_known)
+        return false; // A and B may alias each other
+
+    // The same cell must be tested on entry and on exit, and move by one each iteration
+    const Ptr counter_ptr = tokens[open].ptr;
+    const int64_t counter = counter_ptr == Ptr::A ? 0 : -distance;
+    if((tokens[close].ptr == Ptr::A ? 0 : -distance) != counter)
+        return false;
+    auto counter_change = changes.find(counter);
+    if(counter_change == changes.end())
+        return false;
+    const Cell step = counter_change->second.amount;
+    if(step != 1 && step != (Cell)-1)
+        return false;
+    changes.erase(counter_change);
+
+    std::vector<Instr> rewritten;
+    for(const auto & entry : changes)
+    {
+        const Change & change = entry.second;
+        if(change.amount == 0)
+            continue;
+        if(std::abs(change.offset) > MAX_FOLDED_OFFSET)
+            return false;
+        Instr ins;
+        ins.type = InstrType::MUL_ADD;
+        ins.ptr = change.ptr;
+        ins.src = counter_ptr;
+        ins.offset = (int32_t)change.offset;
+        // The loop runs counter times when counting down, and -counter times when counting up
+        ins.jump = step == 1 ? (Cell)-change.amount : change.amount;
+        ins.position = tokens[open].position;
+        rewritten.push_back(ins);
+    }
+    Instr clear;
+    clear.type = InstrType::SET_ZERO;
+    clear.ptr = counter_ptr;
+    clear.position = tokens[open].position;
+    rewritten.push_back(clear);
+    out.insert(out.end(), rewritten.begin(), rewritten.end());
+    return true;
+}
+
+//Replace clear, copy and multiply loops with SET_ZERO and MUL_ADD instructions
+template<typename Cell>
+void recognize_idioms(std::vector<Instr> & tokens)
+{
+    const std::vector<bool> keeps_distance = loops_keeping_distance(tokens);
+    std::vector<Instr> out;
+    out.reserve(tokens.size());
+
+    // Track A's position minus B's position, as long as it can be proven
+    struct State { bool known; int64_t distance; uint64_t open; };
+    State state{true, 0, 0}; // Both pointers start on the first cell
+    std::stack<State> loops;
+    for(uint64_t pos = 0; pos < tokens.size(); pos++)
+    {
+        const Instr & ins = tokens[pos];
+        const int64_t sign = ins.ptr == Ptr::A ? 1 : -1;
+        switch(ins.type)
+        {
+            case InstrType::RIGHT:
+                state.distance += sign;
+                break;
+            case InstrType::LEFT:
+                state.distance -= sign;
+                break;
+            case InstrType::MOVE:
+                state.distance += sign * (int64_t)ins.jump;
+                break;
+            case InstrType::LOOP_OPEN:
+                if(rewrite_idiom<Cell>(tokens, pos, state.known, state.distance, out))
+                {
+                    pos += ins.jump; // The pointers end where they started
+                    continue;
+                }
+                loops.push(State{state.known, state.distance, pos});
+                // Past the first iteration the distance is only known if iterations keep it
+                state.known = state.known && keeps_distance[pos];
+                break;
+            case InstrType::LOOP_CLOSE:
+                state = loops.top();
+                loops.pop();
+                state.known = state.known && keeps_distance[state.open];
+                break;
+            default:
+                break;
+        }
+        out.push_back(ins);
+    }
+    tokens.swap(out);
+}
+
+// How far back eliminate_dead_code() looks for an instruction to merge another one into
+const uint64_t MAX_MERGE_DISTANCE = 64;
+
+//Whether moving the pointer ptr, if move, or else adding to its cell, has the same effect before ins as after it
+static bool commutes(const Instr & ins, Ptr ptr, bool move)
+{
+    if(ins.ptr == ptr)
+        return false;
+    switch(ins.type)
+    {
+        case InstrType::PLUS:
+        case InstrType::MINUS: // FALLTHROUGH
+        case InstrType::ADD: // FALLTHROUGH
+            return true; // Additions commute even where both pointers are on the same cell
+        case InstrType::LEFT:
+        case InstrType::RIGHT: // FALLTHROUGH
+        case InstrType::MOVE: // FALLTHROUGH
+            return true;
+        case InstrType::SET_ZERO:
+        case InstrType::INPUT: // FALLTHROUGH
+        case InstrType::OUTPUT: // FALLTHROUGH
+        case InstrType::CONSECUTIVE_OUTPUT: // FALLTHROUGH
+            return move; // Where the other pointer's cell is, is up to that pointer alone
+        case InstrType::MUL_ADD:
+            return move && ins.src != ptr;
+        default:
+            return false; // Loops
+    }
+}
+
+//Remove the instructions that can't have any effect: loops and clears on a cell known to be zero, such as a loop
+//right after another one that ended on the same cell, or any loop before the first write to the zeroed tape, and
+//multiplications by such a cell. Additions and moves of a pointer are merged into an earlier one on the same pointer
+//across the other pointer's instructions, dropping pairs like +A>B-A that cancel out. Returns how many tokens it removed.
+template<typename Cell>
+uint64_t eliminate_dead_code(std::vector<Instr> & tokens)
+{
+    std::vector<Instr> out;
+    out.reserve(tokens.size());
+    bool fresh = true;               // Whether no cell was written yet, so that every cell is zero
+    bool zero[2] = {true, true};     // Whether the cell each pointer is on is known to be zero, by pointer
+    std::stack<Ptr> opens;           // The pointer each loop around pos tests on entry
+    for(uint64_t pos = 0; pos < tokens.size(); pos++)
+    {
+        Instr ins = tokens[pos];
+        const int self = (int)ins.ptr;
+        const int other = 1 - self;
+        bool move = false;
+        uint64_t amount = ins.jump;
+        switch(ins.type)
+        {
+            case InstrType::LOOP_OPEN:
+                if(zero[self])
+                {
+                    // Never entered: skip to the matching close
+                    for(uint64_t depth = 1; depth; )
+                    {
+                        pos++;
+                        if(tokens[pos].type == InstrType::LOOP_OPEN)
+                            depth++;
+                        else if(tokens[pos].type == InstrType::LOOP_CLOSE)
+                            depth--;
+                    }
+                    continue;
+                }
+                // Past the first iteration, the body may have written anywhere
+                fresh = false;
+                zero[self] = zero[other] = false;
+                opens.push(ins.ptr);
+                break;
+            case InstrType::LOOP_CLOSE:
+                // A loop that was never entered ends without testing the close's cell, so that cell is only known to
+                // be zero where the open tested the same pointer's
+                zero[self] = opens.top() == ins.ptr;
+                zero[other] = false;
+                opens.pop();
+                break;
+            case InstrType::SET_ZERO:
+                if(zero[self])
+                    continue;
+                zero[self] = true;
+                break;
+            case InstrType::MUL_ADD:
+                if(zero[(int)ins.src] && ins.src_offset == 0)
+                    continue; // Leaves the target untouched
+                fresh = false;
+                zero[self] = zero[other] = false;
+                break;
+            case InstrType::INPUT:
+                fresh = false;
+                zero[self] = zero[other] = false;
+                break;
+            case InstrType::RIGHT:
+                amount = 1;
+                move = true;
+                break;
+            case InstrType::LEFT:
+                amount = -1;
+                move = true;
+                break;
+            case InstrType::MOVE:
+                move = true;
+                break;
+            case InstrType::PLUS:
+                amount = 1;
+                break;
+            case InstrType::MINUS:
+                amount = -1;
+                break;
+            default:
+                break;
+        }
+        const bool merges = move || ins.type == InstrType::PLUS || ins.type == InstrType::MINUS || ins.type == InstrType::ADD;
+        if(!merges)
+        {
+            out.push_back(ins);
+            continue;
+        }
+        if(move)
+            zero[self] = fresh;
+        else
+        {
+            fresh = false;
+            zero[self] = zero[other] = false;
+        }
+        // Add into the latest addition, resp. move, on the same pointer, if the instructions since commute with this one
+        uint64_t at = out.size();
+        while(at > 0 && out.size() - at < MAX_MERGE_DISTANCE && commutes(out[at - 1], ins.ptr, move))
+            at--;
+        if(at > 0 && out[at - 1].ptr == ins.ptr)
+        {
+            Instr & earlier = out[at - 1];
+            const InstrType type = earlier.type;
+            uint64_t total = 0;
+            if(move && (type == InstrType::RIGHT || type == InstrType::LEFT || type == InstrType::MOVE))
+                total = (type == InstrType::RIGHT ? 1 : type == InstrType::LEFT ? -1 : earlier.jump) + amount;
+            else if(!move && (type == InstrType::PLUS || type == InstrType::MINUS || type == InstrType::ADD))
+                total = (Cell)((type == InstrType::PLUS ? 1 : type == InstrType::MINUS ? -1 : earlier.jump) + amount);
+            else
+                at = 0;
+            if(at > 0)
+            {
+                if(total == 0)
+                    out.erase(out.begin() + (at - 1));
+                else
+                {
+                    earlier.type = move ? InstrType::MOVE : InstrType::ADD;
+                    earlier.jump = total;
+                }
+                continue;
+            }
+        }
+        out.push_back(ins);
+    }
+    const uint64_t removed = tokens.size() - out.size();
+    tokens.swap(out);
+    return removed;
+}
+
+//Defer the pointer moves of every straight run of instructions to the loop bracket ending it, and have
+//the instructions in between address their cells at an offset from their pointer instead. A loop body
+//that leaves its pointers where they were then moves neither of them.
+void fold_offsets(std::vector<Instr> & tokens)
+{
+    std::vector<Instr> out;
+    out.reserve(tokens.size());
+    int64_t pending[2] = {0, 0};   // How far each pointer should have moved, by pointer
+    uint64_t moved_at[2] = {0, 0}; // The source position of the first deferred move, by pointer
+    auto flush = [&](Ptr ptr)
+    {
+        if(pending[(int)ptr] == 0)
+            return;
+        Instr move;
+        move.type = InstrType::MOVE;
+        move.ptr = ptr;
+        move.jump = (uint64_t)pending[(int)ptr];
+        move.position = moved_at[(int)ptr];
+        out.push_back(move);
+        pending[(int)ptr] = 0;
+    };
+    for(Instr ins : tokens)
+    {
+        int64_t & moved = pending[(int)ins.ptr];
+        switch(ins.type)
+        {
+            case InstrType::RIGHT:
+            case InstrType::LEFT: // FALLTHROUGH
+            case InstrType::MOVE: // FALLTHROUGH
+            {
+                const int64_t step = ins.type == InstrType::RIGHT ? 1 : ins.type == InstrType::LEFT ? -1 : (int64_t)ins.jump;
+                if(std::abs(moved + step) > MAX_FOLDED_OFFSET)
+                    flush(ins.ptr);
+                if(std::abs(step) > MAX_FOLDED_OFFSET)
+                {
+                    out.push_back(ins);
+                    continue;
+                }
+                if(moved == 0)
+                    moved_at[(int)ins.ptr] = ins.position;
+                moved += step;
+                continue;
+            }
+            case InstrType::PLUS:
+            case InstrType::MINUS: // FALLTHROUGH
+                if(moved)
+                {
+                    ins.jump = ins.type == InstrType::PLUS ? 1 : (uint64_t)-1;
+                    ins.type = InstrType::ADD; // PLUS and MINUS have no offset
+                }
+                // FALLTHROUGH
+            case InstrType::ADD:
+            case InstrType::SET_ZERO: // FALLTHROUGH
+            case InstrType::INPUT: // FALLTHROUGH
+            case InstrType::OUTPUT: // FALLTHROUGH
+            case InstrType::CONSECUTIVE_OUTPUT: // FALLTHROUGH
+                ins.offset = (int32_t)moved;
+                break;
+            case InstrType::MUL_ADD:
+                if(std::abs(moved + ins.offset) > MAX_FOLDED_OFFSET)
+                    flush(ins.ptr);
+                ins.offset += (int32_t)moved;
+                ins.src_offset = (int32_t)pending[(int)ins.src];
+                break;
+            case InstrType::LOOP_OPEN:
+            case InstrType::LOOP_CLOSE: // FALLTHROUGH
+                flush(Ptr::A); // Jumps need both pointers where the source has them
+                flush(Ptr::B);
+                break;
+        }
+        out.push_back(ins);
+    }
+    // Where the pointers end up doesn't matter at the end of the program
+    tokens.swap(out);
+}
+
+//Recompute the jump distances of every loop, after a pass moved instructions around
+void link_loops(std::vector<Instr> & tokens)
+{
+    loop_stack jump_stack;
+    for(uint64_t pos = 0; pos < tokens.size(); pos++)
+    {
+        if(tokens[pos].type == InstrType::LOOP_OPEN)
+        {
+            jump_stack.push(pos);
+        }
+        if(tokens[pos].type == InstrType::LOOP_CLOSE)
+        {
+            uint64_t open = jump_stack.top();
+            jump_stack.pop();
+            uint64_t jump_distance = pos - open;
+            tokens[pos].jump = jump_distance;
+            tokens[open].jump = jump_distance;
+        }
+    }
+}
+
+// What a loop's own instructions, not those of the loops nested in it, do with each pointer
+struct LoopDrift
+{
+    int64_t moved[2];   // How far they move it, by pointer
+    bool touched[2];    // Whether they read or write its cell, by pointer
+};
+
+//Account for the instruction in the loops around it, innermost last, and return the pointers a LOOP_CLOSE should
+//touch before it jumps back, as a mask of 1 << Ptr: those its loop moves without touching their cell. Such a
+//pointer can drift past the guard pages one iteration at a time, and land anywhere once it touches a cell.
+static unsigned drift_probes(std::vector<LoopDrift> & loops, const Instr & ins)
+{
+    unsigned probes = 0;
+    if(ins.type == InstrType::LOOP_CLOSE && !loops.empty())
+    {
+        LoopDrift & loop = loops.back();
+        loop.touched[(int)ins.ptr] = true; // Tested every iteration
+        for(const Ptr ptr : {Ptr::A, Ptr::B})
+            if(loop.moved[(int)ptr] != 0 && !loop.touched[(int)ptr])
+                probes |= 1 << (int)ptr;
+        loops.pop_back();
+    }
+    if(!loops.empty())
+    {
+        LoopDrift & loop = loops.back();
+        switch(ins.type)
+        {
+            case InstrType::RIGHT:
+                loop.moved[(int)ins.ptr]++;
+                break;
+            case InstrType::LEFT:
+                loop.moved[(int)ins.ptr]--;
+                break;
+            case InstrType::MOVE:
+                loop.moved[(int)ins.ptr] += (int64_t)ins.jump;
+                break;
+            case InstrType::MUL_ADD:
+                loop.touched[(int)ins.src] = true;
+                // FALLTHROUGH
+            default:
+                loop.touched[(int)ins.ptr] = true;
+                break;
+        }
+    }
+    if(ins.type == InstrType::LOOP_OPEN)
+        loops.push_back(LoopDrift{{0, 0}, {false, false}});
+    return probes;
+}
+
+//The instruction touching the pointer's cell without changing it, that drift_probes() asks for
+static Instr drift_probe(Ptr ptr, uint64_t position)
+{
+    Instr probe;
+    probe.type = InstrType::ADD; // Of 0, which every engine runs as a read and a write of the cell
+    probe.ptr = ptr;
+    probe.position = position;
+    return probe;
+}
+
+//Have every loop that moves a pointer without touching its cell touch it before jumping back, so that a pointer
+//leaving the tape stops the program in the guard pages, however many iterations it drifts for
+void probe_drifting_loops(std::vector<Instr> & tokens)
+{
+    std::vector<Instr> out;
+    out.reserve(tokens.size());
+    std::vector<LoopDrift> loops;
+    for(const Instr & ins : tokens)
+    {
+        const unsigned probes = drift_probes(loops, ins);
+        for(const Ptr ptr : {Ptr::A, Ptr::B})
+            if(probes & (1 << (int)ptr))
+                out.push_back(drift_probe(ptr, ins.position));
+        out.push_back(ins);
+    }
+    if(out.size() == tokens.size())
+        return;
+    tokens.swap(out);
+    link_loops(tokens);
+}
+
+//The pointers each ] of balanced sanitized instructions touches before jumping back, as drift_probes() has them.
+//Indexed by instruction, two characters each.
+static std::vector<uint8_t> match_probes(const char *instructions)
+{
+    std::vector<uint8_t> probes;
+    std::vector<LoopDrift> loops;
+    for(const char *c = instructions; *c; c += 2)
+    {
+        Instr ins;
+        decode_type(*c, ins.type);
+        ins.ptr = c[1] == 'A' ? Ptr::A : Ptr::B;
+        probes.push_back(drift_probes(loops, ins));
+    }
+    return probes;
+}
+
+//The position of the bracket matching each bracket, for balanced sanitized instructions.
+//Indexed by instruction, two characters each.
+static std::vector<uint64_t> match_brackets(const char *instructions)
+{
+    std::vector<uint64_t> brackets;
+    std::stack<uint64_t> open_brackets;
+    for(const char *c = instructions; *c; c += 2)
+    {
+        brackets.push_back(0);
+        if(*c == '[')
+            open_brackets.push(c - instructions);
+        else if(*c == ']')
+        {
+            assert(!open_brackets.empty()); // Checked when loading
+            brackets.back() = open_brackets.top();
+            brackets[open_brackets.top() / 2] = c - instructions;
+            open_brackets.pop();
+        }
+    }
+    assert(open_brackets.empty());
+    return brackets;
+}
+
+//Interpret and execute the MM code.
+template<typename Cell>
+void execute(const char *instructions, Tape & tape, InputSource & in, OutputSink & out)
+{
+    const std::vector<uint64_t> brackets = match_brackets(instructions);
+    const std::vector<uint8_t> probes = match_probes(instructions);
+    const char *instruction_pointer;         //Keeps track of the interpreter's position in the program.
+    Cell *data_pointer_A;           //Used to modify/read cells on the tape. Controllable.
+    Cell *data_pointer_B;           //Used to modify/read cells on the tape. Controllable.
+
+
+    instruction_pointer = instructions;
+    data_pointer_A = (Cell *)tape.cells();
+    data_pointer_B = (Cell *)tape.cells();
+
+
+    while(*instruction_pointer) //Until the instruction pointer reaches the end of the instructions
+    {
+        Cell **data_ptr; //Holds the address of the pointer specified by the command.
+        switch(*(instruction_pointer + 1))
+        {
+            case 'A':
+                data_ptr = &data_pointer_A;
+                break;
+            case 'B':
+                data_ptr = &data_pointer_B;
+                break;
+            default:
+                assert(false); // Should never happen
+        }
+
+        //Execute the appropriate instruction, using the appropriate data_pointer.
+        switch(*instruction_pointer)
+        {
+            case '+':
+                (**data_ptr)++;
+                break;
+            case '-':
+                (**data_ptr)--;
+                break;
+            case '>':
+                (*data_ptr)++;
+                break;
+            case '<':
+                (*data_ptr)--;
+                break;
+            case '.':
+                out.put(**data_ptr);
+                break;
+            case ',':
+                read_input(in, out, **data_ptr);
+                break;
+            case '[':
+                if(**data_ptr == 0){       //If the data_ptr is zero, skip to the matching close bracket
+                    instruction_pointer = instructions + brackets[(instruction_pointer - instructions) / 2];
+                }                           //If the data_ptr isn't zero, let the interpreter enter the loop.
+                break;
+            case ']':
+                if(**data_ptr != 0){       //If the data_ptr is not zero, jump back into the body of the loop
+                    const uint8_t probe = probes[(instruction_pointer - instructions) / 2];
+                    if(probe & (1 << (int)Ptr::A))
+                        (void)*(volatile Cell *)data_pointer_A;
+                    if(probe & (1 << (int)Ptr::B))
+                        (void)*(volatile Cell *)data_pointer_B;
+                    //Like on every other engine, only the close bracket's pointer is tested here: the open
+                    //bracket's pointer is not tested again, even where it is another pointer
+                    instruction_pointer = instructions + brackets[(instruction_pointer - instructions) / 2];
+                }                           //If the data_ptr isn't zero, let the interpreter exit the loop.
+                break;
+            default:
+                assert(false); // Should never happen
+        }
+        instruction_pointer+=2;         //Move to the next instruction
+    }
+}
+
+// execute_tokens() runs from a byte code packing the tokens tightly, so that large programs stay in cache.
+// Each instruction is an opcode byte, followed by only the operand bytes its type needs:
+//   PACKED_OFFSET set   int32_t  offset of the cell from the pointer (MUL_ADD: of the multiplier), before the rest
+//   ADD                 Cell     amount, modulo the width of the cells it is added to
+//   MOVE                int32_t  distance, longer moves are split
+//   MUL_ADD             int32_t  offset, then Cell factor
+//   CONSECUTIVE_OUTPUT  uint32_t count, longer runs are split
+//   LOOP_OPEN/CLOSE     uint32_t distance in bytes between the two brackets' opcodes
+// A superinstruction is a PACKED_FUSED opcode naming one of the PACKED_FUSIONS, followed by its two
+// instructions, which run in a single dispatch. Jumps never land between the two.
+// Operands are stored unaligned, in the host's byte order.
+enum : uint8_t
+{
+    PACKED_TYPE = 0x0f,  // The InstrType
+    PACKED_B = 0x10,     // Set if the instruction applies to pointer B
+    PACKED_SRC_B = 0x20, // Set if MUL_ADD's multiplier is B's byte
+    PACKED_OFFSET = 0x40, // Set if the cell, or MUL_ADD's multiplier, is at an offset from its pointer
+    PACKED_FUSED = 0x80  // Set for a superinstruction, with the Fusion in the other bits
+};
+
+#define PACKED_TYPES(X) \
+    X(PLUS) X(MINUS) X(LEFT) X(RIGHT) X(INPUT) X(OUTPUT) X(LOOP_OPEN) X(LOOP_CLOSE) \
+    X(ADD) X(MOVE) X(SET_ZERO) X(MUL_ADD) X(CONSECUTIVE_OUTPUT)
+
+// The superinstructions, as pairs of instruction types: the hottest pairs --profile found in the samples
+// and in large generated programs. A row here is all a new one takes. The first of a pair can't jump.
+#define PACKED_FUSIONS(X) \
+    X(ADD, ADD) X(ADD, PLUS) X(ADD, MINUS) X(PLUS, ADD) X(MINUS, ADD) \
+    X(PLUS, PLUS) X(PLUS, MINUS) X(MINUS, PLUS) X(MINUS, MINUS) \
+    X(MOVE, MOVE) X(ADD, MOVE) X(MOVE, LOOP_OPEN) X(MOVE, LOOP_CLOSE) X(ADD, LOOP_OPEN) X(ADD, LOOP_CLOSE) \
+    X(MUL_ADD, SET_ZERO) X(SET_ZERO, MUL_ADD) X(MUL_ADD, MUL_ADD) X(ADD, MUL_ADD) X(SET_ZERO, LOOP_CLOSE) \
+    X(MINUS, LOOP_CLOSE)
+
+enum class Fusion : uint8_t
+{
+#define FUSION_ENUM(first, second) first##_##second,
+    PACKED_FUSIONS(FUSION_ENUM)
+#undef FUSION_ENUM
+};
+
+//The opcode of the superinstruction running first then second, or 0 if there is none
+static uint8_t fused_opcode(InstrType first, InstrType second)
+{
+    static const std::vector<uint8_t> opcodes = []()
+    {
+        std::vector<uint8_t> table(16 * 16, 0);
+#define FUSION_ENTRY(first, second) \
+        assert(InstrType::first != InstrType::LOOP_OPEN && InstrType::first != InstrType::LOOP_CLOSE); \
+        table[(int)InstrType::first * 16 + (int)InstrType::second] = PACKED_FUSED | (uint8_t)Fusion::first##_##second;
+        PACKED_FUSIONS(FUSION_ENTRY)
+#undef FUSION_ENTRY
+        return table;
+    }();
+    return opcodes[(int)first * 16 + (int)second];
+}
+
+//Whether a token packs to a single instruction, so that it can be part of a superinstruction
+static bool packs_to_one(const Instr & instr)
+{
+    if(instr.type == InstrType::MOVE)
+        return (int64_t)instr.jump == (int32_t)instr.jump;
+    if(instr.type == InstrType::CONSECUTIVE_OUTPUT)
+        return instr.jump <= UINT32_MAX;
+    return true;
+}
+
+static uint8_t packed_opcode(InstrType type, Ptr ptr, Ptr src = Ptr::A)
+{
+    return (uint8_t)type | (ptr == Ptr::B ? PACKED_B : 0) | (src == Ptr::B ? PACKED_SRC_B : 0);
+}
+
+template<typename T>
+static void pack_operand(std::vector<uint8_t> & code, T operand)
+{
+    uint8_t bytes[sizeof(T)];
+    memcpy(bytes, &operand, sizeof(T));
+    code.insert(code.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static T packed_operand(const uint8_t *at)
+{
+    T operand;
+    memcpy(&operand, at, sizeof(T));
+    return operand;
+}
+
+//Append the opcode of an instruction on the cell at instr's offset from its pointer
+static void pack_cell_opcode(std::vector<uint8_t> & code, const Instr & instr)
+{
+    code.push_back(packed_opcode(instr.type, instr.ptr) | (instr.offset ? PACKED_OFFSET : 0));
+    if(instr.offset)
+        pack_operand<int32_t>(code, instr.offset);
+}
+
+//Encode the tokens as execute_tokens()'s byte code, for cells of type Cell.
+//If starts isn't null, it receives the position in the code of each token's first instruction: that of the
+//superinstruction for the first of a pair. Without fuse no superinstructions are used, so that every token has its own.
+template<typename Cell>
+static std::vector<uint8_t> pack_tokens(const std::vector<Instr> & instructions, std::vector<uint64_t> *starts = nullptr,
+                                        bool fuse = true)
+{
+    std::vector<uint8_t> code;
+    code.reserve(instructions.size() * 2);
+    loop_stack open_brackets; // Byte positions of the enclosing LOOP_OPENs
+    bool second = false; // Whether this token is the second of a superinstruction
+    for(uint64_t pos = 0; pos < instructions.size(); pos++)
+    {
+        const Instr & instr = instructions[pos];
+        if(starts)
+            starts->push_back(code.size());
+        if(second)
+            second = false;
+        else if(fuse && pos + 1 < instructions.size() && packs_to_one(instr) && packs_to_one(instructions[pos + 1]))
+        {
+            const uint8_t fused = fused_opcode(instr.type, instructions[pos + 1].type);
+            if(fused)
+                code.push_back(fused);
+            second = fused != 0;
+        }
+        switch(instr.type)
+        {
+            case InstrType::ADD:
+                pack_cell_opcode(code, instr);
+                pack_operand<Cell>(code, (Cell)instr.jump);
+                break;
+            case InstrType::MOVE:
+            {
+                int64_t distance = (int64_t)instr.jump;
+                do
+                {
+                    int32_t step = (int32_t)std::max<int64_t>(INT32_MIN, std::min<int64_t>(INT32_MAX, distance));
+                    code.push_back(packed_opcode(instr.type, instr.ptr));
+                    pack_operand<int32_t>(code, step);
+                    distance -= step;
+                } while(distance);
+                break;
+            }
+            case InstrType::MUL_ADD:
+                code.push_back(packed_opcode(instr.type, instr.ptr, instr.src) | (instr.src_offset ? PACKED_OFFSET : 0));
+                if(instr.src_offset)
+                    pack_operand<int32_t>(code, instr.src_offset);
+                pack_operand<int32_t>(code, instr.offset);
+                pack_operand<Cell>(code, (Cell)instr.jump);
+                break;
+            case InstrType::CONSECUTIVE_OUTPUT:
+            {
+                uint64_t count = instr.jump;
+                do
+                {
+                    uint32_t step = (uint32_t)std::min<uint64_t>(UINT32_MAX, count);
+                    pack_cell_opcode(code, instr);
+                    pack_operand<uint32_t>(code, step);
+                    count -= step;
+                } while(count);
+                break;
+            }
+            case InstrType::LOOP_OPEN:
+                open_brackets.push(code.size());
+                code.push_back(packed_opcode(instr.type, instr.ptr));
+                pack_operand<uint32_t>(code, 0); // Patched at the matching LOOP_CLOSE
+                break;
+            case InstrType::LOOP_CLOSE:
+            {
+                assert(!open_brackets.empty());
+                uint64_t distance = code.size() - open_brackets.top();
+                if(distance > UINT32_MAX)
+                {
+                    throw SourceError("Loop too large for the token engine");
+                }
+                memcpy(&code[open_brackets.top() + 1], &distance, sizeof(uint32_t));
+                open_brackets.pop();
+                code.push_back(packed_opcode(instr.type, instr.ptr));
+                pack_operand<uint32_t>(code, (uint32_t)distance);
+                break;
+            }
+            default:
+                pack_cell_opcode(code, instr);
+                break;
+        }
+    }
+    return code;
+}
+
+//The length of the byte code instruction at at, operands included
+template<typename Cell>
+static uint64_t packed_length(const uint8_t *at)
+{
+    if(*at & PACKED_FUSED)
+    {
+        const uint64_t first = packed_length<Cell>(at + 1);
+        return 1 + first + packed_length<Cell>(at + 1 + first);
+    }
+    const uint8_t opcode = *at;
+    const uint64_t offset = opcode & PACKED_OFFSET ? 4 : 0;
+    switch((InstrType)(opcode & PACKED_TYPE))
+    {
+        case InstrType::ADD:
+            return offset + 1 + sizeof(Cell);
+        case InstrType::MOVE:
+        case InstrType::CONSECUTIVE_OUTPUT:
+        case InstrType::LOOP_OPEN:
+        case InstrType::LOOP_CLOSE:
+            return offset + 5;
+        case InstrType::MUL_ADD:
+            return offset + 5 + sizeof(Cell);
+        default:
+            return offset + 1;
+    }
+}
+
+// run_packed() is specialized at compile time by four policies, so that what a run doesn't
+// need costs it nothing:
+//   Io       input(cell), output(c) and output(c, count): performs the program's I/O
+//   Checks   access(cell): told of every cell an instruction reads or writes
+//   Budget   skip(from, to) and back(from, to): told of every jump taken, forward past a loop or back into one
+//   Profile  count(position): told of the code position of every instruction run,
+//            branch(type, taken): of the outcome of every loop bracket, and touch(b, cell): of every cell
+//            accessed, and whether through B. pause(position): asked before every instruction whether to pause the run there
+
+// I/O through a file or pipe, without echo
+struct StreamIo
+{
+    StreamIo(InputSource & in, OutputSink & out) : in(in), out(out) {}
+    template<typename Cell>
+    void input(Cell & cell) { in.get(cell); }
+    void output(uint8_t c) { out.put(c); }
+    void output(uint8_t c, uint64_t count) { out.put(c, count); }
+
+    InputSource & in;
+    OutputSink & out;
+};
+
+// I/O on the console, which shows any prompt before waiting on a key, then echoes it
+struct ConsoleIo : StreamIo
+{
+    using StreamIo::StreamIo;
+    template<typename Cell>
+    void input(Cell & cell)
+    {
+        out.flush();
+        in.get(cell);
+        out.put(cell);
+    }
+};
+
+// Leaves stopping pointers that left the tape to its guard pages
+struct NoChecks
+{
+    void access(const void *) {}
+};
+
+// Checks every access against the tape's bounds, for tapes without guard pages or run with --checked.
+// Throws a TapeError for an access off the tape, before it happens.
+struct BoundsChecks
+{
+    const Tape & tape;
+    template<typename Cell>
+    void access(const Cell *cell)
+    {
+        const uintptr_t at = (uintptr_t)cell;
+        const uintptr_t first = (uintptr_t)tape.cells();
+        if(at >= first && at - first <= tape.size() - sizeof(Cell)) // The whole cell must be on the tape
+            return;
+        throw TapeError(at < first ? TAPE_LEFT_ERROR : TAPE_RIGHT_ERROR);
+    }
+};
+
+// Lets the program run for as long as it takes
+struct NoBudget
+{
+    void skip(const uint8_t *, const uint8_t *) {}
+    void back(const uint8_t *, const uint8_t *) {}
+};
+
+// Counts the instructions run a straight run of them at a time, at the jump that ends it, and stops
+// the program at the next jump back into a loop once it ran out of steps or time.
+template<typename Cell>
+struct StepBudget
+{
+    StepBudget(const std::vector<uint8_t> & code, uint64_t max_steps, const std::atomic<bool> & expired)
+        : code(code.data()), max_steps(max_steps), expired(expired)
+    {
+        mark(0, 0);
+        uint64_t count = 0;
+        for(uint64_t at = 0; at < code.size(); count++)
+        {
+            uint64_t loop = at; // The second instruction of a superinstruction may jump too
+            if(code[at] & PACKED_FUSED)
+                loop = at + 1 + packed_length<Cell>(&code[at + 1]);
+            at += packed_length<Cell>(&code[at]);
+            const InstrType type = (InstrType)(code[loop] & PACKED_TYPE);
+            if(type == InstrType::LOOP_OPEN || type == InstrType::LOOP_CLOSE)
+            {
+                mark(loop, count);
+                mark(at, count + 1); // Where the loop's other end jumps to
+            }
+        }
+    }
+    void skip(const uint8_t *from, const uint8_t *to)
+    {
+        const uint64_t from_ordinal = ordinal(from);
+        steps += from_ordinal + 1 - segment; // The segment, the jump included
+        segment = ordinal(to);
+    }
+    void back(const uint8_t *from, const uint8_t *to)
+    {
+        skip(from, to);
+        if(steps > max_steps)
+            throw LimitExceeded("Stopped after running " + std::to_string(max_steps) + " steps");
+        if(expired.load(std::memory_order_relaxed))
+            throw LimitExceeded("Stopped after running out of time");
+    }
+
+    void mark(uint64_t at, uint64_t count)
+    {
+        if(positions.empty() || positions.back() < at)
+        {
+            positions.push_back(at);
+            ordinals.push_back(count);
+        }
+    }
+    uint64_t ordinal(const uint8_t *at) const
+    {
+        const uint64_t index = std::lower_bound(positions.begin(), positions.end(), (uint64_t)(at - code)) - positions.begin();
+        assert(index < positions.size() && positions[index] == (uint64_t)(at - code));
+        return ordinals[index];
+    }
+
+    const uint8_t *code;
+    std::vector<uint64_t> positions; // In order, the code's start and its loop instructions, and where they jump to
+    std::vector<uint64_t> ordinals;  // The instructions before each of them
+    uint64_t segment = 0;            // The instructions before where those run since the last jump start
+    uint64_t steps = 0;
+    uint64_t max_steps;
+    const std::atomic<bool> & expired;
+};
+
+// Sets expired once the timeout passed, unless it is destroyed first
+class Watchdog
+{
+public:
+    explicit Watchdog(uint64_t timeout_ms)
+    {
+        if(timeout_ms)
+            thread = std::thread([this, timeout_ms]()
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                if(!stopped.wait_for(guard, std::chrono::milliseconds(timeout_ms), [this]() { return done; }))
+                    expired = true;
+            });
+    }
+    ~Watchdog()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            done = true;
+        }
+        stopped.notify_one();
+        if(thread.joinable())
+            thread.join();
+    }
+
+    std::atomic<bool> expired{false};
+
+private:
+    std::mutex lock;
+    std::condition_variable stopped;
+    bool done = false;
+    std::thread thread;
+};
+
+// Stands in for the profiler in normal runs, and compiles to nothing
+struct NoProfile
+{
+    bool pause(uint64_t) { return false; }
+    void count(uint64_t) {}
+    void branch(InstrType, bool) {}
+    void touch(bool, const void *) {}
+};
+
+// Counts how often each instruction of the byte code runs, by position in the code
+struct CodeProfile : NoProfile
+{
+    std::vector<uint64_t> counts;
+    void count(uint64_t at) { counts[at]++; }
+};
+
+// Counts the RunStats of a run on a tape of Cells
+template<typename Cell>
+struct StatsProfile
+{
+    RunStats & stats;
+    const Cell *first; // The tape's first cell
+    bool pause(uint64_t) { return false; }
+    void count(uint64_t) { stats.dispatched++; }
+    void branch(InstrType type, bool taken)
+    {
+        if(type == InstrType::LOOP_OPEN)
+            (taken ? stats.open_taken : stats.open_not_taken)++;
+        else
+            (taken ? stats.close_taken : stats.close_not_taken)++;
+    }
+    void touch(bool b, const Cell *cell)
+    {
+        stats.high_water[b] = std::max<uint64_t>(stats.high_water[b], cell - first);
+    }
+};
+
+// Counts the instructions run, superinstructions counting as one, and pauses the run once pause_at of them ran
+struct StepProfile : NoProfile
+{
+    uint64_t steps = 0;
+    uint64_t pause_at = UINT64_MAX;
+    bool pause(uint64_t) { return steps == pause_at; }
+    void count(uint64_t) { steps++; }
+};
+
+// run_instruction() is written once for both plain instructions and superinstructions, and only
+// pays off inlined into each of them
+#if defined(__GNUC__)
+#define PACKED_INLINE inline __attribute__((always_inline))
+#else
+#define PACKED_INLINE inline
+#endif
+
+// The machine run_packed() runs each instruction on
+template<typename Cell, typename Io, typename Checks, typename Budget, typename Profile>
+struct PackedMachine
+{
+    typedef Cell CellType;
+    Cell *data_pointer_A;           //Used to modify/read cells on the tape. Controllable.
+    Cell *data_pointer_B;           //Used to modify/read cells on the tape. Controllable.
+    Io io;
+    Checks checks;
+    Budget & budget;
+    Profile & profile;
+};
+
+//Run the instruction of the given type at instruction_pointer, and return the instruction to run next
+template<InstrType type, typename Machine>
+static PACKED_INLINE const uint8_t *run_instruction(const uint8_t *instruction_pointer, Machine & machine)
+{
+    typedef typename Machine::CellType Cell;
+    const uint8_t opcode = *instruction_pointer;
+    const uint8_t *operand = instruction_pointer + 1;
+    //The pointer specified by the command, selected by value so that both pointers can stay in registers
+    const bool b = opcode & PACKED_B;
+    Cell *data_ptr = b ? machine.data_pointer_B : machine.data_pointer_A;
+    auto move = [&](int64_t distance) { (b ? machine.data_pointer_B : machine.data_pointer_A) = data_ptr + distance; };
+    int32_t offset = 0;
+    if(opcode & PACKED_OFFSET)
+    {
+        offset = packed_operand<int32_t>(operand);
+        operand += 4;
+    }
+    Cell *cell = data_ptr + offset; // The cell the instruction reads or writes, if any
+    if(type != InstrType::LEFT && type != InstrType::RIGHT && type != InstrType::MOVE && type != InstrType::MUL_ADD)
+    {
+        machine.checks.access(cell); // Every other instruction reads or writes its cell
+        machine.profile.touch(b, cell);
+    }
+
+    //Execute the appropriate instruction, using the appropriate data_pointer.
+    switch(type)
+    {
+        case InstrType::PLUS:
+            (*cell)++;
+            break;
+        case InstrType::MINUS:
+            (*cell)--;
+            break;
+        case InstrType::RIGHT:
+            move(1);
+            break;
+        case InstrType::LEFT:
+            move(-1);
+            break;
+        case InstrType::ADD:
+            (*cell) += packed_operand<Cell>(operand);
+            operand += sizeof(Cell);
+            break;
+        case InstrType::MOVE:
+            move(packed_operand<int32_t>(operand));
+            operand += 4;
+            break;
+        case InstrType::SET_ZERO:
+            (*cell) = 0;
+            break;
+        case InstrType::MUL_ADD:
+        {
+            Cell *src_ptr = (opcode & PACKED_SRC_B ? machine.data_pointer_B : machine.data_pointer_A) + offset;
+            machine.checks.access(src_ptr);
+            machine.profile.touch(opcode & PACKED_SRC_B, src_ptr);
+            if(*src_ptr != 0)
+            {
+                Cell *target = data_ptr + packed_operand<int32_t>(operand);
+                machine.checks.access(target);
+                machine.profile.touch(b, target);
+                *target += (uint32_t)*src_ptr * packed_operand<Cell>(operand + 4); // Unsigned, so that it wraps
+            }
+            operand += 4 + sizeof(Cell);
+            break;
+        }
+        case InstrType::OUTPUT:
+            machine.io.output(*cell);
+            break;
+        case InstrType::CONSECUTIVE_OUTPUT:
+            machine.io.output(*cell, packed_operand<uint32_t>(operand));
+            operand += 4;
+            break;
+        case InstrType::INPUT:
+            machine.io.input(*cell);
+            break;
+        case InstrType::LOOP_OPEN:
+            if(*cell == 0)       //If the cell is zero, skip to the matching close bracket
+            {
+                operand += packed_operand<uint32_t>(operand);
+                operand += 4;
+                machine.budget.skip(instruction_pointer, operand);
+                machine.profile.branch(type, true);
+            }
+            else
+            {
+                operand += 4;
+                machine.profile.branch(type, false);
+            }
+            break;
+        case InstrType::LOOP_CLOSE:
+            if(*cell != 0)       //If the cell is not zero, jump back to the matching open bracket
+            {
+                operand -= packed_operand<uint32_t>(operand);
+                operand += 4;
+                machine.budget.back(instruction_pointer, operand);
+                machine.profile.branch(type, true);
+            }
+            else
+            {
+                operand += 4;
+                machine.profile.branch(type, false);
+            }
+            break;
+    }
+    return operand;
+}
+
+// Where a paused run of the byte code goes on from: the instruction to run next and the cells both pointers are on
+struct PackedState
+{
+    uint64_t at;
+    int64_t a;
+    int64_t b;
+};
+
+//Interpret and execute the byte code with the given policies, on cells of type Cell: run it from state until it
+//ends or the profile pauses it, leave where it stopped in state, and return whether it ended
+template<typename Cell, typename Io, typename Checks, typename Budget, typename Profile>
+static bool run_packed(const std::vector<uint8_t> & code, uint8_t *cells, Io io, Checks checks, Budget & budget, Profile & profile,
+                       PackedState & state)
+{
+    Cell *first = (Cell *)cells;
+    PackedMachine<Cell, Io, Checks, Budget, Profile> machine{first + state.a, first + state.b, io, checks, budget, profile};
+    const uint8_t *instruction_pointer = code.data() + state.at;
+    const uint8_t *code_end = code.data() + code.size();
+    while(instruction_pointer != code_end && !machine.profile.pause(instruction_pointer - code.data()))
+    {
+        machine.profile.count(instruction_pointer - code.data());
+        const uint8_t opcode = *instruction_pointer;
+        switch(opcode & PACKED_FUSED ? opcode : opcode & PACKED_TYPE)
+        {
+#define PACKED_DISPATCH(type) \
+            case (uint8_t)InstrType::type: \
+                instruction_pointer = run_instruction<InstrType::type>(instruction_pointer, machine); \
+                break;
+            PACKED_TYPES(PACKED_DISPATCH)
+#undef PACKED_DISPATCH
+#define FUSED_DISPATCH(first, second) \
+            case PACKED_FUSED | (uint8_t)Fusion::first##_##second: \
+                instruction_pointer = run_instruction<InstrType::first>(instruction_pointer + 1, machine); \
+                instruction_pointer = run_instruction<InstrType::second>(instruction_pointer, machine); \
+                break;
+            PACKED_FUSIONS(FUSED_DISPATCH)
+#undef FUSED_DISPATCH
+            default:
+                assert(false); // Should never happen
+        }
+    }
+    state = PackedState{(uint64_t)(instruction_pointer - code.data()), machine.data_pointer_A - first, machine.data_pointer_B - first};
+    return instruction_pointer == code_end;
+}
+
+//Run the byte code from state until it ends or the profile pauses it, with the I/O and checks policies this run needs
+template<typename Cell, typename Budget, typename Profile>
+static bool run_packed(const std::vector<uint8_t> & code, Tape & tape, InputSource & in, OutputSink & out,
+                       Budget & budget, Profile & profile, PackedState & state)
+{
+    if(in.echoes())
+    {
+        if(tape.checked())
+            return run_packed<Cell>(code, tape.cells(), ConsoleIo(in, out), BoundsChecks{tape}, budget, profile, state);
+        return run_packed<Cell>(code, tape.cells(), ConsoleIo(in, out), NoChecks(), budget, profile, state);
+    }
+    if(tape.checked())
+        return run_packed<Cell>(code, tape.cells(), StreamIo(in, out), BoundsChecks{tape}, budget, profile, state);
+    return run_packed<Cell>(code, tape.cells(), StreamIo(in, out), NoChecks(), budget, profile, state);
+}
+
+//Run the byte code from its start to its end
+template<typename Cell, typename Budget, typename Profile>
+static void run_packed(const std::vector<uint8_t> & code, Tape & tape, InputSource & in, OutputSink & out,
+                       Budget & budget, Profile & profile)
+{
+    PackedState state{0, 0, 0};
+    run_packed<Cell>(code, tape, in, out, budget, profile, state);
+}
+
+//Interpret and execute the MM code.
+template<typename Cell>
+void execute_tokens(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out)
+{
+    NoBudget budget;
+    NoProfile profile;
+    run_packed<Cell>(pack_tokens<Cell>(instructions), tape, in, out, budget, profile);
+}
+
+//Optimize and pack the tokens for cells of type Cell
+template<typename Cell>
+static void compile_tokens(Program & program, bool optimize)
+{
+    if(optimize)
+        program.eliminated = ::optimize<Cell>(program.tokens);
+    probe_drifting_loops(program.tokens);
+    program.code = pack_tokens<Cell>(program.tokens);
+}
+
+//compile_tokens() for the program's cell width
+static void compile_tokens(Program & program, bool optimize)
+{
+    switch(program.cell_bits)
+    {
+        case 16:
+            compile_tokens<uint16_t>(program, optimize);
+            break;
+        case 32:
+            compile_tokens<uint32_t>(program, optimize);
+            break;
+        default:
+            compile_tokens<uint8_t>(program, optimize);
+            break;
+    }
+}
+
+const uint64_t PREFIX_TAPE = 1 << 20;  // The bytes of the tape compile() evaluates programs on
+const uint64_t PREFIX_IMAGE = 1 << 16; // Prefix tapes are whole multiples of this, and so of the page size
+
+static void evaluate_prefix(Program & program);
+
+Program compile(const char *begin, const char *end, Dialect dialect, bool optimize, unsigned cell_bits)
+{
+    assert(cell_bits == 8 || cell_bits == 16 || cell_bits == 32);
+    Program program;
+    program.cell_bits = cell_bits;
+    tokenize_source(begin, end, dialect, program.tokens);
+    if(dialect == Dialect::SWITCH)
+        program.instructions = switch_sanitize(begin, end);
+    else
+        program.instructions = source_sanitize(begin, end);
+    compile_tokens(program, optimize);
+    if(optimize)
+        evaluate_prefix(program);
+    return program;
+}
+
+Program compile(const std::string & source, Dialect dialect, bool optimize, unsigned cell_bits)
+{
+    return compile(source.data(), source.data() + source.size(), dialect, optimize, cell_bits);
+}
+
+const char SAVED_MAGIC[4] = {'M', 'M', 'C', '\0'};
+const uint32_t SAVED_VERSION = 5; // Bumped whenever the tokens, their meaning or the format change
+const uint32_t SAVED_BYTE_ORDER = 0x01020304; // Reads back differently on a machine of the other endianness
+const uint64_t SAVED_TOKEN_SIZE = 27; // type, ptr, src, offset, src_offset, jump, position
+
+//64-bit FNV-1a
+uint64_t hash_source(const char *begin, const char *end)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(const char *c = begin; c != end; c++)
+        hash = (hash ^ (uint8_t)*c) * 0x100000001b3ull;
+    return hash;
+}
+
+bool is_saved_program(const char *begin, const char *end)
+{
+    return end - begin >= (ptrdiff_t)sizeof(SAVED_MAGIC) && std::equal(SAVED_MAGIC, SAVED_MAGIC + sizeof(SAVED_MAGIC), begin);
+}
+
+template<typename T>
+static void save_field(std::ostream & out, T value)
+{
+    out.write((const char*)&value, sizeof(value));
+}
+
+template<typename T>
+static T load_field(const char *& next)
+{
+    T value;
+    memcpy(&value, next, sizeof(value));
+    next += sizeof(value);
+    return value;
+}
+
+//The file is in the machine's byte order: the header, the sanitized source, the tokens, then the prefix if there
+//is one, its tape without the zeros it ends with, for loading it not to evaluate it again
+void save_program(const Program & program, const ProgramKey & key, std::ostream & out)
+{
+    out.write(SAVED_MAGIC, sizeof(SAVED_MAGIC));
+    save_field(out, SAVED_VERSION);
+    save_field(out, SAVED_BYTE_ORDER);
+    save_field(out, key.source_hash);
+    save_field(out, (uint8_t)key.dialect);
+    save_field(out, (uint8_t)key.optimized);
+    save_field(out, (uint8_t)program.cell_bits);
+    save_field(out, program.eliminated);
+    save_field(out, (uint64_t)program.instructions.size());
+    save_field(out, (uint64_t)program.tokens.size());
+    out.write(program.instructions.data(), program.instructions.size());
+    for(const Instr & ins : program.tokens)
+    {
+        save_field(out, ins.type);
+        save_field(out, ins.ptr);
+        save_field(out, ins.src);
+        save_field(out, ins.offset);
+        save_field(out, ins.src_offset);
+        save_field(out, ins.jump);
+        save_field(out, ins.position);
+    }
+    save_field(out, (uint8_t)(program.prefix != nullptr));
+    if(!program.prefix)
+        return;
+    const Snapshot & prefix = *program.prefix;
+    uint64_t stored = prefix.tape->size();
+    while(stored && prefix.tape->bytes()[stored - 1] == 0)
+        stored--;
+    save_field(out, (uint8_t)prefix.ended);
+    save_field(out, prefix.at);
+    save_field(out, prefix.a);
+    save_field(out, prefix.b);
+    save_field(out, (uint64_t)prefix.output.size());
+    save_field(out, prefix.tape->size());
+    save_field(out, stored);
+    out.write(prefix.output.data(), prefix.output.size());
+    out.write((const char *)prefix.tape->bytes(), stored);
+}
+
+//Whether a paused run of the code can go on from state: both pointers on the tape prefixes are evaluated on, and at
+//the start of an instruction, or of the second instruction of a superinstruction, where a loop may jump to
+template<typename Cell>
+static bool resumes_from(const std::vector<uint8_t> & code, const PackedState & state)
+{
+    if(state.a < 0 || state.b < 0 || (uint64_t)state.a >= PREFIX_TAPE / sizeof(Cell) || (uint64_t)state.b >= PREFIX_TAPE / sizeof(Cell))
+        return false;
+    for(uint64_t at = 0; at < code.size() && at <= state.at; at += packed_length<Cell>(&code[at]))
+    {
+        if(at == state.at || ((code[at] & PACKED_FUSED) && at + 1 + packed_length<Cell>(&code[at + 1]) == state.at))
+            return true;
+    }
+    return false;
+}
+
+//Load what save_program() saved after the tokens into the program's prefix, checking it as the engines rely on it
+static void load_prefix(Program & program, const char *& next, const char *end)
+{
+    const uint64_t header_size = 1 + 1 + 8 + 8 + 8 + 8 + 8 + 8;
+    if(next == end)
+        throw SourceError("Truncated compiled program");
+    if(!load_field<uint8_t>(next))
+        return;
+    if((uint64_t)(end - next) < header_size)
+        throw SourceError("Truncated compiled program");
+    std::shared_ptr<Snapshot> prefix(new Snapshot());
+    prefix->ended = load_field<uint8_t>(next) != 0;
+    const PackedState state{load_field<uint64_t>(next), load_field<int64_t>(next), load_field<int64_t>(next)};
+    const uint64_t output = load_field<uint64_t>(next);
+    const uint64_t size = load_field<uint64_t>(next);
+    const uint64_t stored = load_field<uint64_t>(next);
+    if(output > (uint64_t)(end - next) || stored > (uint64_t)(end - next) - output)
+        throw SourceError("Truncated compiled program");
+    bool valid = size % PREFIX_IMAGE == 0 && size <= PREFIX_TAPE && stored <= size;
+    switch(program.cell_bits)
+    {
+        case 16:
+            valid = valid && (prefix->ended || resumes_from<uint16_t>(program.code, state));
+            break;
+        case 32:
+            valid = valid && (prefix->ended || resumes_from<uint32_t>(program.code, state));
+            break;
+        default:
+            valid = valid && (prefix->ended || resumes_from<uint8_t>(program.code, state));
+    }
+    if(!valid)
+        throw SourceError("Corrupt compiled program: invalid prefix");
+    prefix->at = state.at;
+    prefix->a = state.a;
+    prefix->b = state.b;
+    prefix->output.assign(next, output);
+    next += output;
+    std::vector<uint8_t> cells(size);
+    std::copy(next, next + stored, cells.begin());
+    next += stored;
+    prefix->tape.reset(new TapeImage(cells.data(), size));
+    program.prefix = prefix;
+}
+
+Program load_program(const char *begin, const char *end, ProgramKey & key)
+{
+    const uint64_t header_size = sizeof(SAVED_MAGIC) + 4 + 4 + 8 + 1 + 1 + 1 + 8 + 8 + 8;
+    if(!is_saved_program(begin, end) || (uint64_t)(end - begin) < header_size)
+        throw SourceError("Not a compiled MindMeld program");
+    const char *next = begin + sizeof(SAVED_MAGIC);
+    if(load_field<uint32_t>(next) != SAVED_VERSION || load_field<uint32_t>(next) != SAVED_BYTE_ORDER)
+        throw SourceError("Compiled by another version of MindMeld, or on another machine");
+    key.source_hash = load_field<uint64_t>(next);
+    key.dialect = (Dialect)load_field<uint8_t>(next);
+    key.optimized = load_field<uint8_t>(next) != 0;
+    key.cell_bits = load_field<uint8_t>(next);
+    if(key.cell_bits != 8 && key.cell_bits != 16 && key.cell_bits != 32)
+        throw SourceError("Corrupt compiled program: invalid cell width");
+    const uint64_t eliminated = load_field<uint64_t>(next);
+    const uint64_t characters = load_field<uint64_t>(next);
+    const uint64_t count = load_field<uint64_t>(next);
+    if(characters > (uint64_t)(end - next) || count > (uint64_t)(end - next - characters) / SAVED_TOKEN_SIZE)
+        throw SourceError("Truncated compiled program");
+
+    Program program;
+    program.cell_bits = key.cell_bits;
+    program.eliminated = eliminated;
+    program.instructions.assign(next, characters);
+    next += characters;
+    program.tokens.resize(count);
+    for(Instr & ins : program.tokens)
+    {
+        ins.type = load_field<InstrType>(next);
+        ins.ptr = load_field<Ptr>(next);
+        ins.src = load_field<Ptr>(next);
+        ins.offset = load_field<int32_t>(next);
+        ins.src_offset = load_field<int32_t>(next);
+        ins.jump = load_field<uint64_t>(next);
+        ins.position = load_field<uint64_t>(next);
+    }
+    //The engines trust the tokens, so check everything they rely on: the cells an instruction reaches stay within
+    //MAX_FOLDED_OFFSET of its pointer, a move stops short of the end of the guard past the tape, and every loop's
+    //open and close jump to each other, nested like brackets
+    loop_stack opens;
+    for(uint64_t pos = 0; pos < count; pos++)
+    {
+        const Instr & ins = program.tokens[pos];
+        bool valid = ins.type <= InstrType::CONSECUTIVE_OUTPUT && ins.ptr <= Ptr::B && ins.src <= Ptr::B
+                     && std::abs((int64_t)ins.offset) <= MAX_FOLDED_OFFSET && std::abs((int64_t)ins.src_offset) <= MAX_FOLDED_OFFSET;
+        if(ins.type == InstrType::MOVE)
+            valid = valid && (int64_t)ins.jump >= -(int64_t)TAPE_GUARD && (int64_t)ins.jump <= (int64_t)TAPE_GUARD;
+        if(ins.type == InstrType::LOOP_OPEN)
+            opens.push(pos);
+        else if(ins.type == InstrType::LOOP_CLOSE)
+        {
+            valid = valid && !opens.empty() && pos - opens.top() == ins.jump && program.tokens[opens.top()].jump == ins.jump;
+            if(valid)
+                opens.pop();
+        }
+        if(!valid)
+            throw SourceError("Corrupt compiled program: invalid token " + std::to_string(pos));
+    }
+    if(!opens.empty())
+        throw SourceError("Corrupt compiled program: invalid token " + std::to_string(opens.top()));
+    uint64_t depth = 0;
+    for(uint64_t pos = 0; pos < characters; pos += 2)
+    {
+        const char c = program.instructions[pos];
+        if(pos + 1 == characters || !strchr("+-<>,.[]", c) || c == '\0' || (program.instructions[pos + 1] != 'A' && program.instructions[pos + 1] != 'B')
+           || (c == ']' && depth == 0))
+            throw SourceError("Corrupt compiled program: invalid instruction " + std::to_string(pos / 2));
+        if(c == '[')
+            depth++;
+        else if(c == ']')
+            depth--;
+    }
+    if(depth)
+        throw SourceError("Corrupt compiled program: unbalanced brackets");
+    compile_tokens(program, false);
+    load_prefix(program, next, end);
+    if(next != end)
+        throw SourceError("Corrupt compiled program: data past its end");
+    return program;
+}
+
+//Run the program's byte code from state, by default its start, counting stats if not null
+template<typename Cell, typename Budget>
+static void run_code(const Program & program, Tape & tape, InputSource & in, OutputSink & out, Budget & budget, RunStats *stats,
+                     PackedState state = PackedState{0, 0, 0})
+{
+    if(stats)
+    {
+        stats->counted = true;
+        StatsProfile<Cell> profile{*stats, (const Cell *)tape.cells()};
+        run_packed<Cell>(program.code, tape, in, out, budget, profile, state);
+    }
+    else
+    {
+        NoProfile profile;
+        run_packed<Cell>(program.code, tape, in, out, budget, profile, state);
+    }
+}
+
+static bool execute_tiered(const Program & program, Tape & tape, InputSource & in, OutputSink & out, PackedState state);
+
+//run() on cells of type Cell
+template<typename Cell>
+static Engine run_cells(const Program & program, Tape & tape, InputSource & in, OutputSink & out, Engine engine,
+                        const Limits & limits, RunStats *stats)
+{
+    NoBudget budget;
+    if(limits.max_steps || limits.timeout_ms)
+    {
+        Watchdog watchdog(limits.timeout_ms);
+        StepBudget<Cell> steps(program.code, limits.max_steps ? limits.max_steps : UINT64_MAX, watchdog.expired);
+        run_code<Cell>(program, tape, in, out, steps, stats);
+        return Engine::TOKENS;
+    }
+    // The other engines trust the guard pages to stop a pointer leaving the tape, so a tape without them, or one
+    // checked as asked, runs on the tokens engine, which checks every access
+    if(tape.checked())
+        engine = Engine::TOKENS;
+    // The prefix's output and tape stand in for the run up to there, which only the byte code engines can go on from
+    const Snapshot *prefix = program.prefix.get();
+    PackedState start{0, 0, 0};
+    if(prefix && prefix->tape->size() <= tape.size() &&
+       (prefix->ended || engine == Engine::TOKENS || engine == Engine::TIERED))
+    {
+        out.write(prefix->output.data(), prefix->output.size());
+        tape.load(*prefix->tape);
+        if(stats && engine == Engine::TOKENS)
+            stats->counted = true; // Even if nothing is left to run
+        if(prefix->ended)
+            return engine;
+        start = PackedState{prefix->at, prefix->a, prefix->b};
+    }
+    switch(engine)
+    {
+        case Engine::CHARS:
+            execute<Cell>(program.instructions.c_str(), tape, in, out);
+            break;
+        case Engine::TOKENS:
+            run_code<Cell>(program, tape, in, out, budget, stats, start);
+            break;
+        case Engine::TIERED:
+            if(sizeof(Cell) != 1 || !execute_tiered(program, tape, in, out, start))
+            {
+                run_code<Cell>(program, tape, in, out, budget, stats, start);
+                return Engine::TOKENS;
+            }
+            break;
+        case Engine::THREADED:
+            execute_threaded<Cell>(program.tokens, tape, in, out);
+            break;
+        case Engine::JIT:
+            if(sizeof(Cell) != 1 || !execute_jit(program.tokens, tape, in, out))
+            {
+                run_code<Cell>(program, tape, in, out, budget, stats);
+                return Engine::TOKENS;
+            }
+            break;
+    }
+    return engine;
+}
+
+Engine run(const Program & program, Tape & tape, InputSource & in, OutputSink & out, Engine engine, const Limits & limits,
+           RunStats *stats)
+{
+    switch(program.cell_bits)
+    {
+        case 16:
+            return run_cells<uint16_t>(program, tape, in, out, engine, limits, stats);
+        case 32:
+            return run_cells<uint32_t>(program, tape, in, out, engine, limits, stats);
+        default:
+            return run_cells<uint8_t>(program, tape, in, out, engine, limits, stats);
+    }
+}
+
+// A trace is its header, then records, each a tag byte and the numbers it holds as LEB128 varints,
+// zigzag encoded first where signed:
+//   'I' value                  The cell an input stored, EOF conventions applied
+//   'C' steps at a b inputs size runs
+//                              A checkpoint, paused before the instruction at code position at, after inputs inputs.
+//                              The first size bytes of the tape, as runs of a count of unchanged bytes, then a count
+//                              of bytes XORed with those of the last checkpoint, until size bytes are covered.
+//   'E' steps inputs           The end of the run. Missing if the run was stopped by an error.
+const char TRACE_MAGIC[4] = {'M', 'M', 'T', '\0'};
+const uint32_t TRACE_VERSION = 1;
+const uint64_t TRACE_HEADER_SIZE = sizeof(TRACE_MAGIC) + 4 + 4 + 8 + 1 + 1; // + hash of the byte code, cell bits, echo
+const uint64_t TRACE_RUN_GAP = 8; // Unchanged bytes that end a run of changed ones, fewer are cheaper to store XORed
+
+static void put_varint(std::string & out, uint64_t value)
+{
+    for(; value >= 0x80; value >>= 7)
+        out.push_back((char)(value | 0x80));
+    out.push_back((char)value);
+}
+
+static void put_signed(std::string & out, int64_t value)
+{
+    put_varint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static uint64_t get_varint(const char *& next, const char *end)
+{
+    uint64_t value = 0;
+    for(unsigned shift = 0; shift < 64; shift += 7)
+    {
+        if(next == end)
+            throw SourceError("Truncated trace");
+        const uint8_t byte = *next++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return value;
+    }
+    throw SourceError("Corrupt trace: invalid number");
+}
+
+static int64_t get_signed(const char *& next, const char *end)
+{
+    const uint64_t value = get_varint(next, end);
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Writes a trace while the run goes. Every record is written out as soon as it is complete, so that a run stopped
+// by an error, a guard page or a signal leaves a trace of every input it read, which replays up to that error.
+class TraceWriter
+{
+public:
+    TraceWriter(std::ostream & out, const std::vector<uint8_t> & code, unsigned cell_bits, bool echoes) : out(out)
+    {
+        out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        save_field(out, TRACE_VERSION);
+        save_field(out, SAVED_BYTE_ORDER);
+        save_field(out, hash_source((const char *)code.data(), (const char *)code.data() + code.size()));
+        save_field(out, (uint8_t)cell_bits);
+        save_field(out, (uint8_t)echoes);
+        out.flush();
+    }
+
+    template<typename Cell>
+    void input(Cell cell)
+    {
+        records.push_back('I');
+        put_varint(records, cell);
+        inputs++;
+        flush();
+    }
+
+    void checkpoint(uint64_t steps, const PackedState & state, const Tape & tape)
+    {
+        records.push_back('C');
+        put_varint(records, steps);
+        put_varint(records, state.at);
+        put_signed(records, state.a);
+        put_signed(records, state.b);
+        put_varint(records, inputs);
+        const uint64_t size = tape.used();
+        put_varint(records, size);
+        last.resize(size);
+        const uint8_t *cells = tape.cells();
+        for(uint64_t pos = 0; pos < size;)
+        {
+            const uint64_t first = pos;
+            while(pos < size && cells[pos] == last[pos])
+                pos++;
+            const uint64_t changed = pos;
+            for(uint64_t gap = 0; pos < size && gap < TRACE_RUN_GAP; pos++)
+                gap = cells[pos] == last[pos] ? gap + 1 : 0;
+            while(pos > changed && cells[pos - 1] == last[pos - 1]) // The gap that ended the run
+                pos--;
+            put_varint(records, changed - first);
+            put_varint(records, pos - changed);
+            for(uint64_t at = changed; at < pos; at++)
+                records.push_back((char)(cells[at] ^ last[at]));
+        }
+        std::copy(cells, cells + size, last.begin());
+        flush();
+    }
+
+    void end(uint64_t steps)
+    {
+        records.push_back('E');
+        put_varint(records, steps);
+        put_varint(records, inputs);
+        flush();
+    }
+
+private:
+    void flush()
+    {
+        out.write(records.data(), records.size());
+        out.flush();
+        records.clear();
+    }
+
+    std::ostream & out;
+    std::string records;
+    uint64_t inputs = 0;
+    std::vector<uint8_t> last; // The tape at the last checkpoint
+};
+
+// I/O of a traced run, recording every input
+template<typename Base>
+struct TraceIo : Base
+{
+    TraceIo(InputSource & in, OutputSink & out, TraceWriter & writer) : Base(in, out), writer(writer) {}
+    template<typename Cell>
+    void input(Cell & cell)
+    {
+        Base::input(cell);
+        writer.input(cell);
+    }
+
+    TraceWriter & writer;
+};
+
+//Run the byte code, checkpointing it every interval steps
+template<typename Cell, typename Io, typename Checks>
+static void trace_packed(const std::vector<uint8_t> & code, Tape & tape, Io io, Checks checks, TraceWriter & writer,
+                         uint64_t interval)
+{
+    NoBudget budget;
+    StepProfile profile;
+    PackedState state{0, 0, 0};
+    for(profile.pause_at = interval; !run_packed<Cell>(code, tape.cells(), io, checks, budget, profile, state); profile.pause_at += interval)
+        writer.checkpoint(profile.steps, state, tape);
+    writer.end(profile.steps);
+}
+
+//trace_program() on cells of type Cell
+template<typename Cell>
+static void trace_cells(const Program & program, Tape & tape, InputSource & in, OutputSink & out, std::ostream & trace,
+                        uint64_t interval)
+{
+    TraceWriter writer(trace, program.code, program.cell_bits, in.echoes());
+    if(in.echoes())
+    {
+        if(tape.checked())
+            trace_packed<Cell>(program.code, tape, TraceIo<ConsoleIo>(in, out, writer), BoundsChecks{tape}, writer, interval);
+        else
+            trace_packed<Cell>(program.code, tape, TraceIo<ConsoleIo>(in, out, writer), NoChecks(), writer, interval);
+    }
+    else
+    {
+        if(tape.checked())
+            trace_packed<Cell>(program.code, tape, TraceIo<StreamIo>(in, out, writer), BoundsChecks{tape}, writer, interval);
+        else
+            trace_packed<Cell>(program.code, tape, TraceIo<StreamIo>(in, out, writer), NoChecks(), writer, interval);
+    }
+}
+
+void trace_program(const Program & program, Tape & tape, InputSource & in, OutputSink & out, std::ostream & trace,
+                   uint64_t interval)
+{
+    switch(program.cell_bits)
+    {
+        case 16:
+            return trace_cells<uint16_t>(program, tape, in, out, trace, interval);
+        case 32:
+            return trace_cells<uint32_t>(program, tape, in, out, trace, interval);
+        default:
+            return trace_cells<uint8_t>(program, tape, in, out, trace, interval);
+    }
+}
+
+// A trace read back
+struct Trace
+{
+    struct Checkpoint
+    {
+        uint64_t steps;
+        PackedState state;
+        uint64_t inputs;
+        uint64_t size;
+        const char *runs; // The tape, as recorded
+    };
+
+    bool echoes = false;
+    std::vector<uint32_t> inputs;
+    std::vector<Checkpoint> checkpoints;
+    bool ended = false; // Whether the run was recorded to its end, in steps after all the inputs
+    uint64_t steps = 0;
+    const char *end = nullptr; // Of the file the records are in
+};
+
+//Apply the runs of a checkpoint to the tape at the one before it, or only check them if tape is null
+static const char *apply_runs(const char *next, const char *end, uint64_t size, std::vector<uint8_t> *tape)
+{
+    if(tape && tape->size() < size)
+        tape->resize(size);
+    for(uint64_t pos = 0; pos < size;)
+    {
+        const uint64_t unchanged = get_varint(next, end);
+        const uint64_t changed = get_varint(next, end);
+        if(unchanged > size - pos || changed > size - pos - unchanged || changed > (uint64_t)(end - next))
+            throw SourceError("Corrupt trace: checkpoint larger than its tape");
+        pos += unchanged;
+        for(uint64_t at = 0; at < changed; at++)
+        {
+            if(tape)
+                (*tape)[pos] ^= (uint8_t)next[at];
+            pos++;
+        }
+        next += changed;
+    }
+    return next;
+}
+
+static Trace read_trace(const Program & program, const Tape & tape, const char *begin, const char *end)
+{
+    if((uint64_t)(end - begin) < TRACE_HEADER_SIZE || !std::equal(TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC), begin))
+        throw SourceError("Not a MindMeld trace");
+    const char *next = begin + sizeof(TRACE_MAGIC);
+    if(load_field<uint32_t>(next) != TRACE_VERSION || load_field<uint32_t>(next) != SAVED_BYTE_ORDER)
+        throw SourceError("Traced by another version of MindMeld, or on another machine");
+    if(load_field<uint64_t>(next) != hash_source((const char *)program.code.data(), (const char *)program.code.data() + program.code.size())
+       || load_field<uint8_t>(next) != program.cell_bits)
+        throw SourceError("The trace was recorded from another program, or with other flags");
+    Trace trace;
+    trace.end = end;
+    trace.echoes = load_field<uint8_t>(next) != 0;
+    while(next != end && !trace.ended)
+    {
+        const char tag = *next++;
+        if(tag == 'I')
+            trace.inputs.push_back((uint32_t)get_varint(next, end));
+        else if(tag == 'C')
+        {
+            Trace::Checkpoint checkpoint;
+            checkpoint.steps = get_varint(next, end);
+            checkpoint.state.at = get_varint(next, end);
+            checkpoint.state.a = get_signed(next, end);
+            checkpoint.state.b = get_signed(next, end);
+            checkpoint.inputs = get_varint(next, end);
+            checkpoint.size = get_varint(next, end);
+            checkpoint.runs = next;
+            const uint64_t last_steps = trace.checkpoints.empty() ? 0 : trace.checkpoints.back().steps;
+            if(checkpoint.steps <= last_steps || checkpoint.state.at >= program.code.size() || checkpoint.inputs != trace.inputs.size())
+                throw SourceError("Corrupt trace: invalid checkpoint");
+            if(checkpoint.size > tape.size())
+                throw SourceError("The trace was recorded on a larger tape");
+            next = apply_runs(next, end, checkpoint.size, nullptr);
+            trace.checkpoints.push_back(checkpoint);
+        }
+        else if(tag == 'E')
+        {
+            trace.steps = get_varint(next, end);
+            if(get_varint(next, end) != trace.inputs.size())
+                throw SourceError("Corrupt trace: invalid end");
+            trace.ended = true;
+        }
+        else
+            throw SourceError("Corrupt trace: invalid record");
+    }
+    if(next != end)
+        throw SourceError("Corrupt trace: records past its end");
+    return trace;
+}
+
+// I/O of a replay, which reads the input recorded instead
+struct ReplayIo
+{
+    template<typename Cell>
+    void input(Cell & cell)
+    {
+        if(next == trace.inputs.size())
+            throw SourceError("The trace ends before this input, the run it recorded was cut short");
+        if(trace.echoes)
+            out.flush();
+        cell = (Cell)trace.inputs[next++];
+        if(trace.echoes)
+            out.put(cell);
+    }
+    void output(uint8_t c) { out.put(c); }
+    void output(uint8_t c, uint64_t count) { out.put(c, count); }
+
+    const Trace & trace;
+    OutputSink & out;
+    uint64_t & next; // The input to read next
+};
+
+//Replay the byte code from the last checkpoint before seek up to it, or to its end
+template<typename Cell, typename Checks>
+static ReplayStop replay_packed(const Program & program, const Trace & trace, Tape & tape, OutputSink & out, Checks checks,
+                                uint64_t seek)
+{
+    NoBudget budget;
+    StepProfile profile;
+    PackedState state{0, 0, 0};
+    uint64_t input = 0;
+    std::vector<uint8_t> recorded; // The tape at the last checkpoint passed
+    uint64_t next = 0; // The checkpoint to reach next
+    while(seek != UINT64_MAX && next < trace.checkpoints.size() && trace.checkpoints[next].steps <= seek)
+    {
+        apply_runs(trace.checkpoints[next].runs, trace.end, trace.checkpoints[next].size, &recorded);
+        next++;
+    }
+    if(next)
+    {
+        const Trace::Checkpoint & start = trace.checkpoints[next - 1];
+        std::copy(recorded.begin(), recorded.end(), tape.cells());
+        profile.steps = start.steps;
+        state = start.state;
+        input = start.inputs;
+    }
+
+    ReplayStop stop;
+    ReplayIo io{trace, out, input};
+    for(;; next++)
+    {
+        profile.pause_at = next < trace.checkpoints.size() ? std::min(trace.checkpoints[next].steps, seek) : seek;
+        stop.ended = run_packed<Cell>(program.code, tape.cells(), io, checks, budget, profile, state);
+        if(stop.ended || profile.steps == seek)
+            break;
+        const Trace::Checkpoint & checkpoint = trace.checkpoints[next];
+        apply_runs(checkpoint.runs, trace.end, checkpoint.size, &recorded);
+        if(state.at != checkpoint.state.at || state.a != checkpoint.state.a || state.b != checkpoint.state.b
+           || input != checkpoint.inputs || !std::equal(recorded.begin(), recorded.end(), tape.cells()))
+            throw SourceError("The replay diverged from the trace at step " + std::to_string(profile.steps));
+    }
+    if(stop.ended && (next < trace.checkpoints.size() || (trace.ended && (profile.steps != trace.steps || input != trace.inputs.size()))))
+        throw SourceError("The replay diverged from the trace, ending at step " + std::to_string(profile.steps));
+    stop.steps = profile.steps;
+    stop.a = state.a;
+    stop.b = state.b;
+    if(!stop.ended)
+    {
+        std::vector<uint64_t> starts;
+        pack_tokens<Cell>(program.tokens, &starts);
+        stop.token = std::lower_bound(starts.begin(), starts.end(), state.at) - starts.begin();
+    }
+    return stop;
+}
+
+//replay_program() on cells of type Cell
+template<typename Cell>
+static ReplayStop replay_cells(const Program & program, const Trace & trace, Tape & tape, OutputSink & out, uint64_t seek)
+{
+    if(tape.checked())
+        return replay_packed<Cell>(program, trace, tape, out, BoundsChecks{tape}, seek);
+    return replay_packed<Cell>(program, trace, tape, out, NoChecks(), seek);
+}
+
+ReplayStop replay_program(const Program & program, const char *begin, const char *end, Tape & tape, OutputSink & out,
+                          uint64_t seek)
+{
+    const Trace trace = read_trace(program, tape, begin, end);
+    switch(program.cell_bits)
+    {
+        case 16:
+            return replay_cells<uint16_t>(program, trace, tape, out, seek);
+        case 32:
+            return replay_cells<uint32_t>(program, trace, tape, out, seek);
+        default:
+            return replay_cells<uint8_t>(program, trace, tape, out, seek);
+    }
+}
+
+//Whether the instruction, or superinstruction, at instruction_pointer reads input
+static bool reads_input(const uint8_t *instruction_pointer)
+{
+    const uint8_t opcode = *instruction_pointer;
+    if(!(opcode & PACKED_FUSED))
+        return (opcode & PACKED_TYPE) == (uint8_t)InstrType::INPUT;
+    switch(opcode)
+    {
+#define FUSED_INPUT(first, second) \
+        case PACKED_FUSED | (uint8_t)Fusion::first##_##second: \
+            return InstrType::first == InstrType::INPUT || InstrType::second == InstrType::INPUT;
+        PACKED_FUSIONS(FUSED_INPUT)
+#undef FUSED_INPUT
+    }
+    return false;
+}
+
+// Pauses the run before the first instruction reading input, or once it ran max_steps or output max_output bytes
+struct InputProfile : NoProfile
+{
+    const uint8_t *code = nullptr;
+    const uint64_t *output = nullptr; // The bytes output so far
+    uint64_t steps = 0;
+    uint64_t max_steps = UINT64_MAX;
+    uint64_t max_output = UINT64_MAX;
+    bool pause(uint64_t at) { return steps == max_steps || *output >= max_output || reads_input(code + at); }
+    void count(uint64_t) { steps++; }
+};
+
+// I/O of a run up to its first input, which never reads any
+struct OutputIo
+{
+    template<typename Cell>
+    void input(Cell &) { assert(false); }
+    void output(uint8_t c)
+    {
+        out.put(c);
+        written++;
+    }
+    void output(uint8_t c, uint64_t count)
+    {
+        out.put(c, count);
+        written += count;
+    }
+
+    OutputSink & out;
+    uint64_t & written;
+};
+
+//snapshot_program() on cells of type Cell
+template<typename Cell>
+static void snapshot_cells(const Program & program, Tape & tape, OutputSink & out, Snapshot & snapshot)
+{
+    NoBudget budget;
+    uint64_t written = 0;
+    InputProfile profile;
+    profile.code = program.code.data();
+    profile.output = &written;
+    PackedState state{0, 0, 0};
+    if(tape.checked())
+        snapshot.ended = run_packed<Cell>(program.code, tape.cells(), OutputIo{out, written}, BoundsChecks{tape}, budget, profile, state);
+    else
+        snapshot.ended = run_packed<Cell>(program.code, tape.cells(), OutputIo{out, written}, NoChecks(), budget, profile, state);
+    snapshot.at = state.at;
+    snapshot.a = state.a;
+    snapshot.b = state.b;
+}
+
+Snapshot snapshot_program(const Program & program, uint64_t tape_size, bool checked)
+{
+    Snapshot snapshot;
+    Tape tape(tape_size, checked);
+    std::ostringstream output;
+    {
+        OutputSink out(output, true, false);
+        switch(program.cell_bits)
+        {
+            case 16:
+                snapshot_cells<uint16_t>(program, tape, out, snapshot);
+                break;
+            case 32:
+                snapshot_cells<uint32_t>(program, tape, out, snapshot);
+                break;
+            default:
+                snapshot_cells<uint8_t>(program, tape, out, snapshot);
+                break;
+        }
+    }
+    snapshot.output = output.str();
+    if(!snapshot.ended)
+        snapshot.tape.reset(new TapeImage(tape));
+    return snapshot;
+}
+
+// Thrown to give up evaluating a program at compile time where it accesses a cell past the bytes it has,
+// for its runs to go there themselves
+struct LeftEvaluation {};
+
+// Checks every access of a run at compile time against the bytes it has
+struct EvaluationChecks
+{
+    const uint8_t *first;
+    uint64_t size;
+    uint64_t & reach; // Past the furthest byte accessed
+    template<typename Cell>
+    void access(const Cell *cell)
+    {
+        const uintptr_t at = (uintptr_t)cell - (uintptr_t)first;
+        if((uintptr_t)cell < (uintptr_t)first || at > size - sizeof(Cell))
+            throw LeftEvaluation();
+        reach = std::max<uint64_t>(reach, at + sizeof(Cell));
+    }
+};
+
+//evaluate_prefix() on cells of type Cell
+template<typename Cell>
+static void evaluate_prefix_cells(Program & program)
+{
+    std::unique_ptr<uint8_t[]> cells(new uint8_t[PREFIX_TAPE]()); // Zeroed, as every run's tape starts
+    std::ostringstream output;
+    uint64_t written = 0;
+    uint64_t reach = 0;
+    NoBudget budget;
+    InputProfile profile;
+    profile.code = program.code.data();
+    profile.output = &written;
+    profile.max_steps = PREFIX_STEPS;
+    profile.max_output = PREFIX_OUTPUT;
+    PackedState state{0, 0, 0};
+    std::shared_ptr<Snapshot> prefix(new Snapshot());
+    try
+    {
+        OutputSink out(output, true, false);
+        prefix->ended = run_packed<Cell>(program.code, cells.get(), OutputIo{out, written},
+                                         EvaluationChecks{cells.get(), PREFIX_TAPE, reach}, budget, profile, state);
+        out.flush();
+    }
+    catch(const LeftEvaluation &)
+    {
+        return;
+    }
+    if(profile.steps == 0 || state.a < 0 || state.b < 0 || (uint64_t)state.a >= PREFIX_TAPE / sizeof(Cell)
+       || (uint64_t)state.b >= PREFIX_TAPE / sizeof(Cell))
+        return; // Nothing to keep, or pointers that moved off the tape without touching it there
+    prefix->output = output.str();
+    prefix->at = state.at;
+    prefix->a = state.a;
+    prefix->b = state.b;
+    prefix->tape.reset(new TapeImage(cells.get(), (reach + PREFIX_IMAGE - 1) / PREFIX_IMAGE * PREFIX_IMAGE));
+    program.prefix = prefix;
+}
+
+//Run the program's byte code at compile time, as far as it goes without input, into its prefix
+static void evaluate_prefix(Program & program)
+{
+    switch(program.cell_bits)
+    {
+        case 16:
+            return evaluate_prefix_cells<uint16_t>(program);
+        case 32:
+            return evaluate_prefix_cells<uint32_t>(program);
+        default:
+            return evaluate_prefix_cells<uint8_t>(program);
+    }
+}
+
+void resume(const Program & program, const Snapshot & snapshot, Tape & tape, InputSource & in, OutputSink & out)
+{
+    out.write(snapshot.output.data(), snapshot.output.size());
+    if(snapshot.ended)
+        return;
+    tape.load(*snapshot.tape);
+    NoBudget budget;
+    NoProfile profile;
+    PackedState state{snapshot.at, snapshot.a, snapshot.b};
+    switch(program.cell_bits)
+    {
+        case 16:
+            run_packed<uint16_t>(program.code, tape, in, out, budget, profile, state);
+            break;
+        case 32:
+            run_packed<uint32_t>(program.code, tape, in, out, budget, profile, state);
+            break;
+        default:
+            run_packed<uint8_t>(program.code, tape, in, out, budget, profile, state);
+    }
+}
+
+// The tokens streamed from a source per publish(), small enough for the first ones to run right away
+const uint64_t STREAM_BATCH = 1 << 12;
+
+// The tokens of a source, tokenized on a thread of their own while run_stream() runs those published so far.
+// Tokens are written once into memory reserved for the whole source, so they never move. Only the jumps of
+// loops closed after their [ was published change afterwards, and those are written under the lock.
+class TokenStream
+{
+public:
+    TokenStream(const char *begin, const char *end, Dialect dialect);
+    TokenStream(const TokenStream &) = delete;
+    TokenStream & operator=(const TokenStream &) = delete;
+    ~TokenStream();
+
+    template<typename Cell>
+    void start() { producer = std::thread(&TokenStream::produce<Cell>, this); }
+
+    const Instr *tokens() const { return storage; }
+    //The number of tokens published, once it is more than count or the whole source was tokenized.
+    //Throws the SourceError that stopped the tokenizer if there are no more.
+    uint64_t wait_beyond(uint64_t count);
+    //The jump of the published LOOP_OPEN at open, once its ] was tokenized
+    uint64_t wait_closed(uint64_t open);
+
+private:
+    template<typename Cell> void produce();
+    template<typename Cell> void publish(std::vector<Instr> & batch);
+    void finish(const std::string & failure);
+
+    const char *begin;
+    const char *end;
+    Dialect dialect;
+    Instr *storage = nullptr;
+    uint64_t capacity;
+    std::unique_ptr<Instr[]> allocated; // Where no address space could be reserved
+    std::thread producer;
+
+    // Only the producer uses these
+    uint64_t appended = 0;
+    loop_stack opens; // The tokens of the loops appended and not closed yet
+    std::vector<LoopDrift> drift; // What those loops do with the pointers, for drift_probes()
+    std::vector<std::pair<uint64_t, uint64_t>> links; // Jumps of published LOOP_OPENs, until the next publish
+
+    std::mutex lock;
+    std::condition_variable grown;
+    uint64_t published = 0;            // Tokens the engine may run. Written under the lock.
+    bool done = false;                 // Whether the whole source was tokenized, or the tokenizer stopped
+    std::atomic<bool> finished{false}; // done, read without the lock: the tokens no longer change
+    std::string error;                 // Why the tokenizer stopped, if it did
+};
+
+TokenStream::TokenStream(const char *begin, const char *end, Dialect dialect)
+    : begin(begin), end(end), dialect(dialect), capacity(std::max<uint64_t>(1, end - begin))
+{
+    // Every token takes at least one character of the source
+#ifdef __unix
+    void *region = mmap(nullptr, capacity * sizeof(Instr), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(region != MAP_FAILED)
+    {
+        storage = (Instr *)region;
+        return;
+    }
+#endif
+    allocated.reset(new Instr[capacity]);
+    storage = allocated.get();
+}
+
+TokenStream::~TokenStream()
+{
+    if(producer.joinable())
+        producer.join();
+#ifdef __unix
+    if(!allocated)
+        munmap(storage, capacity * sizeof(Instr));
+#endif
+}
+
+uint64_t TokenStream::wait_beyond(uint64_t count)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    grown.wait(guard, [&]() { return published > count || done; });
+    if(published <= count && !error.empty())
+        throw SourceError(error);
+    return published;
+}
+
+uint64_t TokenStream::wait_closed(uint64_t open)
+{
+    std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+    if(!finished.load(std::memory_order_acquire))
+    {
+        guard.lock();
+        grown.wait(guard, [&]() { return storage[open].jump != 0 || done; });
+    }
+    if(storage[open].jump == 0)
+        throw SourceError(error); // Never closed
+    return storage[open].jump;
+}
+
+//Tokenize the source, publishing the tokens a batch at a time, until it ends or turns out malformed
+template<typename Cell>
+void TokenStream::produce()
+{
+    std::vector<Instr> batch;
+    batch.reserve(STREAM_BATCH);
+    std::stack<const char *> open_positions; // For reporting unclosed loops
+    try
+    {
+        scan_tokens(begin, end, dialect, [&](const Instr & ins, const char *at)
+        {
+            if(ins.type == InstrType::LOOP_OPEN)
+                open_positions.push(at);
+            if(ins.type == InstrType::LOOP_CLOSE)
+            {
+                if(open_positions.empty())
+                    source_error(begin, at, "Unmatched ]");
+                open_positions.pop();
+            }
+            batch.push_back(ins);
+            if(batch.size() == STREAM_BATCH)
+                publish<Cell>(batch);
+        });
+        if(!open_positions.empty())
+            source_error(begin, open_positions.top(), "Unclosed [");
+        publish<Cell>(batch);
+        finish("");
+    }
+    catch(const SourceError & failure)
+    {
+        publish<Cell>(batch); // The instructions before the error still run
+        finish(failure.what());
+    }
+}
+
+//Fold the runs of the batch, append it to the tokens linking its loops, and let the engine run it
+template<typename Cell>
+void TokenStream::publish(std::vector<Instr> & batch)
+{
+    fold_runs<Cell>(batch); // Runs crossing batches are left split
+    for(const Instr & ins : batch)
+    {
+        // A probe is only added to a loop that switched pointers, which took a character of its own
+        const unsigned probes = drift_probes(drift, ins);
+        for(const Ptr ptr : {Ptr::A, Ptr::B})
+            if(probes & (1 << (int)ptr))
+                new (&storage[appended++]) Instr(drift_probe(ptr, ins.position));
+        new (&storage[appended]) Instr(ins);
+        if(ins.type == InstrType::LOOP_OPEN)
+            opens.push(appended);
+        else if(ins.type == InstrType::LOOP_CLOSE)
+        {
+            const uint64_t open = opens.top();
+            opens.pop();
+            const uint64_t jump = appended - open;
+            storage[appended].jump = jump;
+            if(open >= published)
+                storage[open].jump = jump; // Not published yet
+            else
+                links.push_back(std::make_pair(open, jump));
+        }
+        appended++;
+    }
+    batch.clear();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for(const auto & link : links)
+            storage[link.first].jump = link.second;
+        published = appended;
+    }
+    links.clear();
+    grown.notify_all();
+}
+
+void TokenStream::finish(const std::string & failure)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        error = failure;
+        done = true;
+        finished.store(true, std::memory_order_release);
+    }
+    grown.notify_all();
+}
+
+//Run the tokens of the stream as they are published, waiting where the run catches up with the tokenizer
+template<typename Cell, typename Io, typename Checks>
+static void run_stream(TokenStream & stream, Tape & tape, Io io, Checks checks)
+{
+    const Instr *tokens = stream.tokens();
+    Cell *data_pointer_A = (Cell *)tape.cells();
+    Cell *data_pointer_B = (Cell *)tape.cells();
+    uint64_t available = 0;
+    for(uint64_t ip = 0;; ip++)
+    {
+        if(ip >= available)
+        {
+            available = stream.wait_beyond(ip);
+            if(ip >= available)
+                return; // The end of the program
+        }
+        const Instr & ins = tokens[ip]; // Read field by field: the jump of a LOOP_OPEN may still change
+        Cell *& data_ptr = ins.ptr == Ptr::B ? data_pointer_B : data_pointer_A;
+        if(ins.type != InstrType::LEFT && ins.type != InstrType::RIGHT && ins.type != InstrType::MOVE)
+            checks.access(data_ptr);
+        switch(ins.type)
+        {
+            case InstrType::PLUS:
+                (*data_ptr)++;
+                break;
+            case InstrType::MINUS:
+                (*data_ptr)--;
+                break;
+            case InstrType::RIGHT:
+                data_ptr++;
+                break;
+            case InstrType::LEFT:
+                data_ptr--;
+                break;
+            case InstrType::ADD:
+                *data_ptr += (Cell)ins.jump;
+                break;
+            case InstrType::MOVE:
+                data_ptr += (int64_t)ins.jump;
+                break;
+            case InstrType::OUTPUT:
+                io.output(*data_ptr);
+                break;
+            case InstrType::CONSECUTIVE_OUTPUT:
+                io.output(*data_ptr, ins.jump);
+                break;
+            case InstrType::INPUT:
+                io.input(*data_ptr);
+                break;
+            case InstrType::LOOP_OPEN:
+                if(*data_ptr == 0) // Skip past the matching close bracket, once it was tokenized
+                    ip += stream.wait_closed(ip);
+                break;
+            case InstrType::LOOP_CLOSE:
+                if(*data_ptr != 0) // Jump back past the matching open bracket
+                    ip -= ins.jump;
+                break;
+            default:
+                assert(false); // Should never happen: only runs are folded
+        }
+    }
+}
+
+//run_streaming() on cells of type Cell
+template<typename Cell>
+static void run_streaming(const char *begin, const char *end, Dialect dialect, Tape & tape, InputSource & in, OutputSink & out)
+{
+    TokenStream stream(begin, end, dialect);
+    stream.start<Cell>();
+    if(in.echoes())
+    {
+        if(tape.checked())
+            run_stream<Cell>(stream, tape, ConsoleIo(in, out), BoundsChecks{tape});
+        else
+            run_stream<Cell>(stream, tape, ConsoleIo(in, out), NoChecks());
+    }
+    else
+    {
+        if(tape.checked())
+            run_stream<Cell>(stream, tape, StreamIo(in, out), BoundsChecks{tape});
+        else
+            run_stream<Cell>(stream, tape, StreamIo(in, out), NoChecks());
+    }
+}
+
+void run_streaming(const char *begin, const char *end, Dialect dialect, Tape & tape, InputSource & in, OutputSink & out,
+                   unsigned cell_bits)
+{
+    switch(cell_bits)
+    {
+        case 16:
+            run_streaming<uint16_t>(begin, end, dialect, tape, in, out);
+            break;
+        case 32:
+            run_streaming<uint32_t>(begin, end, dialect, tape, in, out);
+            break;
+        default:
+            run_streaming<uint8_t>(begin, end, dialect, tape, in, out);
+            break;
+    }
+}
+
+//The name of an instruction type, as in InstrType
+static const char *type_name(InstrType type)
+{
+    static const char * const names[] = {
+        "PLUS", "MINUS", "LEFT", "RIGHT", "INPUT", "OUTPUT", "LOOP_OPEN", "LOOP_CLOSE",
+        "ADD", "MOVE", "SET_ZERO", "MUL_ADD", "CONSECUTIVE_OUTPUT"
+    };
+    return names[(int)type];
+}
+
+//The line:column of each position in a source, from the offsets where its lines start
+static std::string source_location(const std::vector<uint64_t> & line_starts, uint64_t position)
+{
+    auto line = std::upper_bound(line_starts.begin(), line_starts.end(), position) - 1;
+    return std::to_string(line - line_starts.begin() + 1) + ":" + std::to_string(position - *line + 1);
+}
+
+//Run the tokens like execute_tokens(), and return how often each of them ran
+template<typename Cell>
+static std::vector<uint64_t> count_tokens(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out)
+{
+    std::vector<uint64_t> starts;
+    const std::vector<uint8_t> code = pack_tokens<Cell>(instructions, &starts, false);
+    NoBudget budget;
+    CodeProfile profile;
+    profile.counts.resize(code.size());
+    run_packed<Cell>(code, tape, in, out, budget, profile);
+    out.flush();
+
+    std::vector<uint64_t> counts(instructions.size());
+    for(uint64_t pos = 0; pos < instructions.size(); pos++)
+        counts[pos] = profile.counts[starts[pos]];
+    return counts;
+}
+
+//Like execute_tokens(), but count how often every token and loop runs. Afterwards, write a report
+//of the hottest loops and tokens, by their line and column in source, and the instructions run
+//inside each nesting of loops as a flame graph's folded stacks.
+void profile_tokens(const std::vector<Instr> & instructions, const char *source_begin, const char *source_end,
+                    Tape & tape, InputSource & in, OutputSink & out, std::ostream & report, std::ostream & folded,
+                    unsigned cell_bits)
+{
+    const std::vector<uint64_t> counts = // Executions of each token
+        cell_bits == 16 ? count_tokens<uint16_t>(instructions, tape, in, out)
+        : cell_bits == 32 ? count_tokens<uint32_t>(instructions, tape, in, out)
+        : count_tokens<uint8_t>(instructions, tape, in, out);
+    std::vector<uint64_t> line_starts{0};
+    for(const char *c = source_begin; c != source_end; c++)
+        if(*c == '\n')
+            line_starts.push_back(c + 1 - source_begin);
+    auto describe = [&](uint64_t pos)
+    {
+        const Instr & ins = instructions[pos];
+        std::string name(1, source_character(ins.type));
+        switch(ins.type) // The optimizer's instructions, shown at the source they replaced
+        {
+            case InstrType::ADD:
+                name = "ADD ";
+                break;
+            case InstrType::MOVE:
+                name = "MOVE ";
+                break;
+            case InstrType::SET_ZERO:
+                name = "SET_ZERO ";
+                break;
+            case InstrType::MUL_ADD:
+                name = "MUL_ADD ";
+                break;
+            case InstrType::CONSECUTIVE_OUTPUT:
+                name = "CONSECUTIVE_OUTPUT ";
+                break;
+            default:
+                break;
+        }
+        name += ins.ptr == Ptr::A ? 'A' : 'B';
+        if(ins.offset)
+            name += "[" + std::to_string(ins.offset) + "]";
+        return name + "@" + source_location(line_starts, ins.position);
+    };
+
+    // Each loop's executions, including the loops nested in it, and its innermost enclosing loop
+    struct Loop { uint64_t open, close, executed, self; int64_t parent; };
+    std::vector<Loop> loops;
+    std::vector<int64_t> innermost(instructions.size(), -1);
+    std::stack<int64_t> enclosing;
+    uint64_t total = 0;
+    for(uint64_t pos = 0; pos < instructions.size(); pos++)
+    {
+        if(instructions[pos].type == InstrType::LOOP_OPEN)
+        {
+            loops.push_back(Loop{pos, 0, 0, 0, enclosing.empty() ? -1 : enclosing.top()});
+            enclosing.push(loops.size() - 1);
+        }
+        innermost[pos] = enclosing.empty() ? -1 : enclosing.top();
+        if(instructions[pos].type == InstrType::LOOP_CLOSE)
+        {
+            loops[enclosing.top()].close = pos;
+            enclosing.pop();
+        }
+        total += counts[pos];
+        if(innermost[pos] >= 0)
+            loops[innermost[pos]].self += counts[pos];
+        for(int64_t loop = innermost[pos]; loop >= 0; loop = loops[loop].parent)
+            loops[loop].executed += counts[pos];
+    }
+
+    auto percent = [&](uint64_t count) { return total ? 100.0 * count / total : 0.0; };
+    report << std::fixed << std::setprecision(1) << std::endl << "Profile: " << total << " instructions executed" << std::endl;
+    std::vector<uint64_t> ranked(loops.size());
+    std::iota(ranked.begin(), ranked.end(), 0);
+    std::stable_sort(ranked.begin(), ranked.end(), [&](uint64_t a, uint64_t b) { return loops[a].executed > loops[b].executed; });
+    report << "Hot loops (instructions run inside, entries, iterations):" << std::endl;
+    for(uint64_t rank = 0; rank < ranked.size() && rank < 10 && loops[ranked[rank]].executed; rank++)
+    {
+        const Loop & loop = loops[ranked[rank]];
+        report << "  " << describe(loop.open) << "  " << loop.executed << " (" << percent(loop.executed) << "%), "
+               << counts[loop.open] << ", " << counts[loop.close] << std::endl;
+    }
+    ranked.resize(instructions.size());
+    std::iota(ranked.begin(), ranked.end(), 0);
+    std::stable_sort(ranked.begin(), ranked.end(), [&](uint64_t a, uint64_t b) { return counts[a] > counts[b]; });
+    report << "Hot tokens (executions):" << std::endl;
+    for(uint64_t rank = 0; rank < ranked.size() && rank < 10 && counts[ranked[rank]]; rank++)
+        report << "  " << describe(ranked[rank]) << "  " << counts[ranked[rank]] << " (" << percent(counts[ranked[rank]]) << "%)" << std::endl;
+    // How often each type of instruction ran straight into each other type, to choose superinstructions from
+    std::map<std::pair<InstrType, InstrType>, uint64_t> pairs;
+    for(uint64_t pos = 0; pos + 1 < instructions.size(); pos++)
+        if(instructions[pos].type != InstrType::LOOP_OPEN && instructions[pos].type != InstrType::LOOP_CLOSE && counts[pos])
+            pairs[std::make_pair(instructions[pos].type, instructions[pos + 1].type)] += counts[pos];
+    std::vector<std::pair<std::pair<InstrType, InstrType>, uint64_t>> ranked_pairs(pairs.begin(), pairs.end());
+    std::stable_sort(ranked_pairs.begin(), ranked_pairs.end(), [](const std::pair<std::pair<InstrType, InstrType>, uint64_t> & a,
+                                                                  const std::pair<std::pair<InstrType, InstrType>, uint64_t> & b)
+                                                               { return a.second > b.second; });
+    report << "Hot pairs (executions of the first, followed by the second):" << std::endl;
+    for(uint64_t rank = 0; rank < ranked_pairs.size() && rank < 10; rank++)
+        report << "  " << type_name(ranked_pairs[rank].first.first) << " " << type_name(ranked_pairs[rank].first.second) << "  "
+               << ranked_pairs[rank].second << " (" << percent(ranked_pairs[rank].second) << "%)" << std::endl;
+
+    // One line per loop nesting: the loops from the outermost in, then the instructions run directly inside
+    uint64_t top_level = total;
+    for(const Loop & loop : loops)
+        if(loop.parent < 0)
+            top_level -= loop.executed;
+    if(top_level)
+        folded << "program " << top_level << std::endl;
+    for(uint64_t index = 0; index < loops.size(); index++)
+    {
+        if(!loops[index].self)
+            continue;
+        std::vector<std::string> frames;
+        for(int64_t loop = index; loop >= 0; loop = loops[loop].parent)
+            frames.push_back(describe(loops[loop].open));
+        folded << "program";
+        for(auto frame = frames.rbegin(); frame != frames.rend(); frame++)
+            folded << ';' << *frame;
+        folded << ' ' << loops[index].self << std::endl;
+    }
+}
+
+
+// The opcodes of the threaded engine, an instruction type with its pointer folded in
+#define THREADED_OPCODES(X) \
+    X(PLUS_A) X(PLUS_B) X(MINUS_A) X(MINUS_B) \
+    X(LEFT_A) X(LEFT_B) X(RIGHT_A) X(RIGHT_B) \
+    X(INPUT_A) X(INPUT_B) X(OUTPUT_A) X(OUTPUT_B) \
+    X(LOOP_OPEN_A) X(LOOP_OPEN_B) X(LOOP_CLOSE_A) X(LOOP_CLOSE_B) \
+    X(ADD_A) X(ADD_B) X(MOVE_A) X(MOVE_B) X(SET_ZERO_A) X(SET_ZERO_B) \
+    X(MUL_ADD_AA) X(MUL_ADD_AB) X(MUL_ADD_BA) X(MUL_ADD_BB) \
+    X(CONSECUTIVE_OUTPUT_A) X(CONSECUTIVE_OUTPUT_B) \
+    X(END)
+
+enum class ThreadedOp : uint8_t
+{
+#define THREADED_ENUM(name) name,
+    THREADED_OPCODES(THREADED_ENUM)
+#undef THREADED_ENUM
+};
+
+// Labels-as-values is a GNU extension, other compilers get a switch instead
+#if defined(__GNUC__)
+#define THREADED_COMPUTED_GOTO 1
+#endif
+
+// A pre-decoded instruction of the threaded engine
+struct ThreadedInstr
+{
+    ThreadedOp op;
+    const void *label = nullptr; // Address of the handler, when using computed gotos
+    int32_t offset = 0;          // Position of the byte affected relative to the pointer, as in Instr
+    int32_t src_offset = 0;      // MUL_ADD: position of the multiplier byte relative to its pointer
+    union
+    {
+        uint64_t operand;            // ADD/MOVE/MUL_ADD/CONSECUTIVE_OUTPUT
+        const ThreadedInstr *target; // Loops: instruction following the matching bracket
+    };
+};
+
+//Fold the pointer of every token into its opcode, and resolve loop jumps to addresses
+static std::vector<ThreadedInstr> thread_tokens(const std::vector<Instr> & instructions)
+{
+    std::vector<ThreadedInstr> code(instructions.size() + 1);
+    for(uint64_t pos = 0; pos < instructions.size(); pos++)
+    {
+        const Instr & ins = instructions[pos];
+        const int b = ins.ptr == Ptr::B ? 1 : 0;
+        ThreadedInstr & out = code[pos];
+        out.operand = ins.jump;
+        out.offset = ins.offset;
+        out.src_offset = ins.src_offset;
+        switch(ins.type)
+        {
+            case InstrType::PLUS:
+                out.op = b ? ThreadedOp::PLUS_B : ThreadedOp::PLUS_A;
+                break;
+            case InstrType::MINUS:
+                out.op = b ? ThreadedOp::MINUS_B : ThreadedOp::MINUS_A;
+                break;
+            case InstrType::LEFT:
+                out.op = b ? ThreadedOp::LEFT_B : ThreadedOp::LEFT_A;
+                break;
+            case InstrType::RIGHT:
+                out.op = b ? ThreadedOp::RIGHT_B : ThreadedOp::RIGHT_A;
+                break;
+            case InstrType::INPUT:
+                out.op = b ? ThreadedOp::INPUT_B : ThreadedOp::INPUT_A;
+                break;
+            case InstrType::OUTPUT:
+                out.op = b ? ThreadedOp::OUTPUT_B : ThreadedOp::OUTPUT_A;
+                break;
+            case InstrType::LOOP_OPEN:
+                out.op = b ? ThreadedOp::LOOP_OPEN_B : ThreadedOp::LOOP_OPEN_A;
+                out.target = &code[pos + ins.jump + 1];
+                break;
+            case InstrType::LOOP_CLOSE:
+                out.op = b ? ThreadedOp::LOOP_CLOSE_B : ThreadedOp::LOOP_CLOSE_A;
+                out.target = &code[pos - ins.jump + 1];
+                break;
+            case InstrType::ADD:
+                out.op = b ? ThreadedOp::ADD_B : ThreadedOp::ADD_A;
+                break;
+            case InstrType::MOVE:
+                out.op = b ? ThreadedOp::MOVE_B : ThreadedOp::MOVE_A;
+                break;
+            case InstrType::SET_ZERO:
+                out.op = b ? ThreadedOp::SET_ZERO_B : ThreadedOp::SET_ZERO_A;
+                break;
+            case InstrType::MUL_ADD:
+                if(ins.src == Ptr::A)
+                    out.op = b ? ThreadedOp::MUL_ADD_BA : ThreadedOp::MUL_ADD_AA;
+                else
+                    out.op = b ? ThreadedOp::MUL_ADD_BB : ThreadedOp::MUL_ADD_AB;
+                break;
+            case InstrType::CONSECUTIVE_OUTPUT:
+                out.op = b ? ThreadedOp::CONSECUTIVE_OUTPUT_B : ThreadedOp::CONSECUTIVE_OUTPUT_A;
+                break;
+        }
+    }
+    code.back().op = ThreadedOp::END;
+    return code;
+}
+
+//Interpret and execute the MM code, dispatching directly from one handler to the next.
+template<typename Cell>
+void execute_threaded(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out)
+{
+    std::vector<ThreadedInstr> code = thread_tokens(instructions);
+    Cell *a = (Cell *)tape.cells();
+    Cell *b = (Cell *)tape.cells();
+    const ThreadedInstr *ip = code.data();
+
+#ifdef THREADED_COMPUTED_GOTO
+#define THREADED_LABEL(name) &&op_##name,
+    static const void * const labels[] = { THREADED_OPCODES(THREADED_LABEL) };
+#undef THREADED_LABEL
+    for(ThreadedInstr & ins : code)
+        ins.label = labels[(int)ins.op];
+#define OP(name) op_##name:
+#define NEXT goto *ip->label
+    NEXT;
+#else
+#define OP(name) case ThreadedOp::name:
+#define NEXT continue
+    for(;;) switch(ip->op) {
+#endif
+
+    OP(PLUS_A) a[ip->offset]++; ip++; NEXT;
+    OP(PLUS_B) b[ip->offset]++; ip++; NEXT;
+    OP(MINUS_A) a[ip->offset]--; ip++; NEXT;
+    OP(MINUS_B) b[ip->offset]--; ip++; NEXT;
+    OP(LEFT_A) a--; ip++; NEXT;
+    OP(LEFT_B) b--; ip++; NEXT;
+    OP(RIGHT_A) a++; ip++; NEXT;
+    OP(RIGHT_B) b++; ip++; NEXT;
+    OP(INPUT_A) read_input(in, out, a[ip->offset]); ip++; NEXT;
+    OP(INPUT_B) read_input(in, out, b[ip->offset]); ip++; NEXT;
+    OP(OUTPUT_A) out.put(a[ip->offset]); ip++; NEXT;
+    OP(OUTPUT_B) out.put(b[ip->offset]); ip++; NEXT;
+    OP(LOOP_OPEN_A) ip = *a == 0 ? ip->target : ip + 1; NEXT;
+    OP(LOOP_OPEN_B) ip = *b == 0 ? ip->target : ip + 1; NEXT;
+    OP(LOOP_CLOSE_A) ip = *a != 0 ? ip->target : ip + 1; NEXT;
+    OP(LOOP_CLOSE_B) ip = *b != 0 ? ip->target : ip + 1; NEXT;
+    OP(ADD_A) a[ip->offset] += ip->operand; ip++; NEXT;
+    OP(ADD_B) b[ip->offset] += ip->operand; ip++; NEXT;
+    OP(MOVE_A) a += (int64_t)ip->operand; ip++; NEXT;
+    OP(MOVE_B) b += (int64_t)ip->operand; ip++; NEXT;
+    OP(SET_ZERO_A) a[ip->offset] = 0; ip++; NEXT;
+    OP(SET_ZERO_B) b[ip->offset] = 0; ip++; NEXT;
+    OP(MUL_ADD_AA) if(a[ip->src_offset]) a[ip->offset] += a[ip->src_offset] * ip->operand; ip++; NEXT;
+    OP(MUL_ADD_AB) if(b[ip->src_offset]) a[ip->offset] += b[ip->src_offset] * ip->operand; ip++; NEXT;
+    OP(MUL_ADD_BA) if(a[ip->src_offset]) b[ip->offset] += a[ip->src_offset] * ip->operand; ip++; NEXT;
+    OP(MUL_ADD_BB) if(b[ip->src_offset]) b[ip->offset] += b[ip->src_offset] * ip->operand; ip++; NEXT;
+    OP(CONSECUTIVE_OUTPUT_A) out.put(a[ip->offset], ip->operand); ip++; NEXT;
+    OP(CONSECUTIVE_OUTPUT_B) out.put(b[ip->offset], ip->operand); ip++; NEXT;
+    OP(END) return;
+
+#ifndef THREADED_COMPUTED_GOTO
+    }
+#endif
+#undef OP
+#undef NEXT
+}
+
+// I/O of the JIT compiled code calls back into these, with the same behaviour as the interpreters
+struct JitIO
+{
+    InputSource *in;
+    OutputSink *out;
+};
+
+extern "C" void mm_jit_output(JitIO *io, uint8_t c)
+{
+    io->out->put(c);
+}
+
+extern "C" void mm_jit_output_repeat(JitIO *io, uint8_t c, uint64_t count)
+{
+    io->out->put(c, count);
+}
+
+//Return the new value of the cell, which starts out as c
+extern "C" uint8_t mm_jit_input(JitIO *io, uint8_t c)
+{
+    read_input(*io->in, *io->out, c);
+    return c;
+}
+
+#ifdef JIT_SUPPORTED
+#if defined(__x86_64__)
+
+// The A and B pointers live in rbx and r14, and the JitIO in r15, which all survive calls to the I/O trampolines
+static const uint8_t X86_REG[2] = { 3, 14 };
+
+static void x86_imm32(std::vector<uint8_t> & code, uint32_t imm)
+{
+    for(int byte = 0; byte < 4; byte++)
+        code.push_back((imm >> (8 * byte)) & 0xff);
+}
+
+//Emit an opcode whose r/m operand is the byte at ptr + disp
+static void x86_mem(std::vector<uint8_t> & code, std::initializer_list<uint8_t> opcode,
+                    uint8_t reg_field, Ptr ptr, int32_t disp)
+{
+    const uint8_t base = X86_REG[(int)ptr];
+    if(base & 8)
+        code.push_back(0x41); // REX.B
+    code.insert(code.end(), opcode);
+    const uint8_t rm = ((reg_field & 7) << 3) | (base & 7);
+    if(disp == 0 && (base & 7) != 5)
+    {
+        code.push_back(rm);
+    }
+    else if(disp == (int8_t)disp)
+    {
+        code.push_back(0x40 | rm);
+        code.push_back((uint8_t)disp);
+    }
+    else
+    {
+        code.push_back(0x80 | rm);
+        x86_imm32(code, disp);
+    }
+}
+
+static void x86_call(std::vector<uint8_t> & code, const void *function)
+{
+    code.push_back(0x48); // mov rax, imm64
+    code.push_back(0xb8);
+    uint64_t address = (uint64_t)function;
+    for(int byte = 0; byte < 8; byte++)
+        code.push_back((address >> (8 * byte)) & 0xff);
+    code.push_back(0xff); // call rax
+    code.push_back(0xd0);
+}
+
+//Translate the tokens from first up to last to a function taking the A and B pointers, which it updates, in the array in
+//rdi and the JitIO in rsi. If in_body, first is a LOOP_OPEN and the function starts in its body.
+static bool jit_compile(const std::vector<Instr> & instructions, uint64_t first, uint64_t last, bool in_body,
+                        std::vector<uint8_t> & code)
+{
+    std::vector<uint64_t> body_start(instructions.size()); // LOOP_OPEN: code offset after its jump
+    code.insert(code.end(), {
+        0x53,                   // push rbx
+        0x41, 0x56,             // push r14
+        0x41, 0x57,             // push r15
+        0x57,                   // push rdi
+        0x48, 0x83, 0xec, 0x08, // sub rsp, 8, which keeps the stack aligned for calls
+        0x48, 0x8b, 0x1f,       // mov rbx, [rdi]
+        0x4c, 0x8b, 0x77, 0x08, // mov r14, [rdi + 8]
+        0x49, 0x89, 0xf7        // mov r15, rsi
+    });
+    const uint64_t enter_end = code.size() + 5;
+    if(in_body)
+    {
+        code.push_back(0xe9); // jmp rel32, past the check of the open, patched below
+        x86_imm32(code, 0);
+    }
+    for(uint64_t pos = first; pos < last; pos++)
+    {
+        const Instr & ins = instructions[pos];
+        const uint8_t reg = X86_REG[(int)ins.ptr];
+        uint64_t amount = ins.jump;
+        switch(ins.type)
+        {
+            case InstrType::PLUS:
+                amount = 1;
+                // FALLTHROUGH
+            case InstrType::MINUS:
+                if(ins.type == InstrType::MINUS)
+                    amount = -1;
+                // FALLTHROUGH
+            case InstrType::ADD:
+                x86_mem(code, {0x80}, 0, ins.ptr, ins.offset); // add byte [ptr + offset], imm8
+                code.push_back(amount & 0xff);
+                break;
+            case InstrType::RIGHT:
+                amount = 1;
+                // FALLTHROUGH
+            case InstrType::LEFT:
+                if(ins.type == InstrType::LEFT)
+                    amount = -1;
+                // FALLTHROUGH
+            case InstrType::MOVE:
+                if((int64_t)amount != (int32_t)amount)
+                    return false;
+                code.push_back(reg & 8 ? 0x49 : 0x48); // add ptr, imm32
+                code.push_back(0x81);
+                code.push_back(0xc0 | (reg & 7));
+                x86_imm32(code, (uint32_t)amount);
+                break;
+            case InstrType::SET_ZERO:
+                x86_mem(code, {0xc6}, 0, ins.ptr, ins.offset); // mov byte [ptr + offset], 0
+                code.push_back(0);
+                break;
+            case InstrType::MUL_ADD:
+            {
+                x86_mem(code, {0x0f, 0xb6}, 0, ins.src, ins.src_offset); // movzx eax, byte [src + src_offset]
+                code.insert(code.end(), {0x85, 0xc0, 0x74, 0}); // test eax, eax; jz rel8, patched below
+                const uint64_t skip_from = code.size();
+                const uint8_t factor = amount & 0xff;
+                if(factor == 0xff)
+                {
+                    x86_mem(code, {0x28}, 0, ins.ptr, ins.offset); // sub [ptr + offset], al
+                }
+                else
+                {
+                    if(factor != 1)
+                    {
+                        code.insert(code.end(), {0x69, 0xc0}); // imul eax, eax, imm32
+                        x86_imm32(code, factor);
+                    }
+                    x86_mem(code, {0x00}, 0, ins.ptr, ins.offset); // add [ptr + offset], al
+                }
+                code[skip_from - 1] = code.size() - skip_from;
+                break;
+            }
+            case InstrType::OUTPUT:
+                code.insert(code.end(), {0x4c, 0x89, 0xff});  // mov rdi, r15
+                x86_mem(code, {0x0f, 0xb6}, 6, ins.ptr, ins.offset); // movzx esi, byte [ptr + offset]
+                x86_call(code, (const void *)&mm_jit_output);
+                break;
+            case InstrType::CONSECUTIVE_OUTPUT:
+                code.insert(code.end(), {0x4c, 0x89, 0xff});  // mov rdi, r15
+                x86_mem(code, {0x0f, 0xb6}, 6, ins.ptr, ins.offset); // movzx esi, byte [ptr + offset]
+                code.insert(code.end(), {0x48, 0xba});        // mov rdx, imm64
+                for(int byte = 0; byte < 8; byte++)
+                    code.push_back((amount >> (8 * byte)) & 0xff);
+                x86_call(code, (const void *)&mm_jit_output_repeat);
+                break;
+            case InstrType::INPUT:
+                code.insert(code.end(), {0x4c, 0x89, 0xff});  // mov rdi, r15
+                x86_mem(code, {0x0f, 0xb6}, 6, ins.ptr, ins.offset); // movzx esi, byte [ptr + offset]
+                x86_call(code, (const void *)&mm_jit_input);
+                x86_mem(code, {0x88}, 0, ins.ptr, ins.offset); // mov [ptr + offset], al
+                break;
+            case InstrType::LOOP_OPEN:
+                x86_mem(code, {0x80}, 7, ins.ptr, 0); // cmp byte [ptr], 0
+                code.push_back(0);
+                code.insert(code.end(), {0x0f, 0x84}); // je rel32, patched at the matching close
+                x86_imm32(code, 0);
+                body_start[pos] = code.size();
+                if(in_body && pos == first)
+                {
+                    const uint32_t into = code.size() - enter_end;
+                    for(int byte = 0; byte < 4; byte++)
+                        code[enter_end - 4 + byte] = (into >> (8 * byte)) & 0xff;
+                }
+                break;
+            case InstrType::LOOP_CLOSE:
+            {
+                const uint64_t open_end = body_start[pos - ins.jump];
+                x86_mem(code, {0x80}, 7, ins.ptr, 0); // cmp byte [ptr], 0
+                code.push_back(0);
+                code.insert(code.end(), {0x0f, 0x85}); // jne rel32, back to the loop body
+                x86_imm32(code, (uint32_t)(open_end - (code.size() + 4)));
+                const uint32_t skip = code.size() - open_end;
+                for(int byte = 0; byte < 4; byte++)
+                    code[open_end - 4 + byte] = (skip >> (8 * byte)) & 0xff;
+                break;
+            }
+        }
+    }
+    code.insert(code.end(), {
+        0x48, 0x83, 0xc4, 0x08, // add rsp, 8
+        0x5f,                   // pop rdi
+        0x48, 0x89, 0x1f,       // mov [rdi], rbx
+        0x4c, 0x89, 0x77, 0x08, // mov [rdi + 8], r14
+        0x41, 0x5f,             // pop r15
+        0x41, 0x5e,             // pop r14
+        0x5b,                   // pop rbx
+        0xc3                    // ret
+    });
+    return code.size() < (1ull << 31);
+}
+
+#elif defined(__aarch64__)
+
+// The A and B pointers live in x19 and x20, and the JitIO in x21, which all survive calls to the I/O trampolines
+static const uint32_t ARM_REG[2] = { 19, 20 };
+
+static void arm_emit(std::vector<uint8_t> & code, uint32_t word)
+{
+    for(int byte = 0; byte < 4; byte++)
+        code.push_back((word >> (8 * byte)) & 0xff);
+}
+
+//Load a 64-bit constant into x<reg>
+static void arm_mov_imm(std::vector<uint8_t> & code, uint32_t reg, uint64_t imm)
+{
+    arm_emit(code, 0xd2800000 | ((imm & 0xffff) << 5) | reg); // movz
+    for(uint32_t half = 1; half < 4; half++)
+    {
+        uint32_t bits = (imm >> (16 * half)) & 0xffff;
+        if(bits)
+            arm_emit(code, 0xf2800000 | (half << 21) | (bits << 5) | reg); // movk
+    }
+}
+
+//Leave the address ptr + offset in x10 and return its register
+static uint32_t arm_address(std::vector<uint8_t> & code, Ptr ptr, int32_t offset)
+{
+    const uint32_t base = ARM_REG[(int)ptr];
+    if(offset == 0)
+        return base;
+    arm_mov_imm(code, 11, (uint64_t)(int64_t)offset);
+    arm_emit(code, 0x8b000000 | (11 << 16) | (base << 5) | 10); // add x10, base, x11
+    return 10;
+}
+
+static void arm_write_word(std::vector<uint8_t> & code, uint64_t at, uint32_t word)
+{
+    for(int byte = 0; byte < 4; byte++)
+        code[at + byte] = (word >> (8 * byte)) & 0xff;
+}
+
+//Translate the tokens from first up to last to a function taking the A and B pointers, which it updates, in the array in
+//x0 and the JitIO in x1. If in_body, first is a LOOP_OPEN and the function starts in its body.
+static bool jit_compile(const std::vector<Instr> & instructions, uint64_t first, uint64_t last, bool in_body,
+                        std::vector<uint8_t> & code)
+{
+    std::vector<uint64_t> body_start(instructions.size()); // LOOP_OPEN: code offset after its branch
+    arm_emit(code, 0xa9bd7bfd); // stp x29, x30, [sp, #-48]!
+    arm_emit(code, 0x910003fd); // mov x29, sp
+    arm_emit(code, 0xa90153f3); // stp x19, x20, [sp, #16]
+    arm_emit(code, 0xf90013f5); // str x21, [sp, #32]
+    arm_emit(code, 0xf90017e0); // str x0, [sp, #40]
+    arm_emit(code, 0xf9400013); // ldr x19, [x0]
+    arm_emit(code, 0xf9400414); // ldr x20, [x0, #8]
+    arm_emit(code, 0xaa0103f5); // mov x21, x1
+    const uint64_t enter_at = code.size();
+    if(in_body)
+        arm_emit(code, 0x14000000); // b past the check of the open, patched below
+    for(uint64_t pos = first; pos < last; pos++)
+    {
+        const Instr & ins = instructions[pos];
+        const uint32_t reg = ARM_REG[(int)ins.ptr];
+        uint64_t amount = ins.jump;
+        switch(ins.type)
+        {
+            case InstrType::PLUS:
+                amount = 1;
+                // FALLTHROUGH
+            case InstrType::MINUS:
+                if(ins.type == InstrType::MINUS)
+                    amount = -1;
+                // FALLTHROUGH
+            case InstrType::ADD:
+            {
+                const uint32_t cell = arm_address(code, ins.ptr, ins.offset);
+                arm_emit(code, 0x39400000 | (cell << 5) | 9);                  // ldrb w9, [cell]
+                arm_emit(code, 0x11000000 | ((amount & 0xff) << 10) | (9 << 5) | 9); // add w9, w9, #amount
+                arm_emit(code, 0x39000000 | (cell << 5) | 9);                  // strb w9, [cell]
+                break;
+            }
+            case InstrType::RIGHT:
+                amount = 1;
+                // FALLTHROUGH
+            case InstrType::LEFT:
+                if(ins.type == InstrType::LEFT)
+                    amount = -1;
+                // FALLTHROUGH
+            case InstrType::MOVE:
+                if((int64_t)amount > 0 && (int64_t)amount < 4096)
+                    arm_emit(code, 0x91000000 | (amount << 10) | (reg << 5) | reg); // add ptr, ptr, #amount
+                else if((int64_t)amount < 0 && -(int64_t)amount < 4096)
+                    arm_emit(code, 0xd1000000 | ((-amount) << 10) | (reg << 5) | reg); // sub ptr, ptr, #-amount
+                else
+                {
+                    arm_mov_imm(code, 11, amount);
+                    arm_emit(code, 0x8b000000 | (11 << 16) | (reg << 5) | reg); // add ptr, ptr, x11
+                }
+                break;
+            case InstrType::SET_ZERO:
+                arm_emit(code, 0x39000000 | (arm_address(code, ins.ptr, ins.offset) << 5) | 31); // strb wzr, [cell]
+                break;
+            case InstrType::MUL_ADD:
+            {
+                arm_emit(code, 0x39400000 | (arm_address(code, ins.src, ins.src_offset) << 5) | 9); // ldrb w9, [src + src_offset]
+                const uint64_t skip_at = code.size();
+                arm_emit(code, 0x34000000 | 9); // cbz w9, past the update, patched below
+                const uint32_t target = arm_address(code, ins.ptr, ins.offset);
+                arm_emit(code, 0x52800000 | ((amount & 0xff) << 5) | 12);      // movz w12, #factor
+                arm_emit(code, 0x1b007c00 | (12 << 16) | (9 << 5) | 9);        // mul w9, w9, w12
+                arm_emit(code, 0x39400000 | (target << 5) | 12);               // ldrb w12, [target]
+                arm_emit(code, 0x0b000000 | (9 << 16) | (12 << 5) | 12);       // add w12, w12, w9
+                arm_emit(code, 0x39000000 | (target << 5) | 12);               // strb w12, [target]
+                arm_write_word(code, skip_at, 0x34000000 | (((code.size() - skip_at) / 4) << 5) | 9);
+                break;
+            }
+            case InstrType::OUTPUT:
+                arm_emit(code, 0xaa1503e0);                  // mov x0, x21
+                arm_emit(code, 0x39400000 | (arm_address(code, ins.ptr, ins.offset) << 5) | 1); // ldrb w1, [cell]
+                arm_mov_imm(code, 16, (uint64_t)&mm_jit_output);
+                arm_emit(code, 0xd63f0000 | (16 << 5));      // blr x16
+                break;
+            case InstrType::CONSECUTIVE_OUTPUT:
+                arm_emit(code, 0xaa1503e0);                  // mov x0, x21
+                arm_emit(code, 0x39400000 | (arm_address(code, ins.ptr, ins.offset) << 5) | 1); // ldrb w1, [cell]
+                arm_mov_imm(code, 2, amount);
+                arm_mov_imm(code, 16, (uint64_t)&mm_jit_output_repeat);
+                arm_emit(code, 0xd63f0000 | (16 << 5));      // blr x16
+                break;
+            case InstrType::INPUT:
+                arm_emit(code, 0xaa1503e0);                  // mov x0, x21
+                arm_emit(code, 0x39400000 | (arm_address(code, ins.ptr, ins.offset) << 5) | 1); // ldrb w1, [cell]
+                arm_mov_imm(code, 16, (uint64_t)&mm_jit_input);
+                arm_emit(code, 0xd63f0000 | (16 << 5));      // blr x16
+                arm_emit(code, 0x39000000 | (arm_address(code, ins.ptr, ins.offset) << 5) | 0); // strb w0, [cell], again after the call
+                break;
+            case InstrType::LOOP_OPEN:
+                arm_emit(code, 0x39400000 | (reg << 5) | 9); // ldrb w9, [ptr]
+                arm_emit(code, 0x35000000 | (2 << 5) | 9);   // cbnz w9, body
+                arm_emit(code, 0x14000000);                  // b after the loop, patched at the matching close
+                body_start[pos] = code.size();
+                if(in_body && pos == first)
+                    arm_write_word(code, enter_at, 0x14000000 | (((code.size() - enter_at) / 4) & 0x3ffffff));
+                break;
+            case InstrType::LOOP_CLOSE:
+            {
+                const uint64_t open_end = body_start[pos - ins.jump];
+                arm_emit(code, 0x39400000 | (reg << 5) | 9); // ldrb w9, [ptr]
+                arm_emit(code, 0x34000000 | (2 << 5) | 9);   // cbz w9, after
+                const int64_t back = ((int64_t)open_end - (int64_t)code.size()) / 4;
+                arm_emit(code, 0x14000000 | (back & 0x3ffffff)); // b body
+                const int64_t skip = ((int64_t)code.size() - (int64_t)(open_end - 4)) / 4;
+                arm_write_word(code, open_end - 4, 0x14000000 | (skip & 0x3ffffff));
+                break;
+            }
+        }
+    }
+    arm_emit(code, 0xf94017e0); // ldr x0, [sp, #40]
+    arm_emit(code, 0xa9005013); // stp x19, x20, [x0]
+    arm_emit(code, 0xf94013f5); // ldr x21, [sp, #32]
+    arm_emit(code, 0xa94153f3); // ldp x19, x20, [sp, #16]
+    arm_emit(code, 0xa8c37bfd); // ldp x29, x30, [sp], #48
+    arm_emit(code, 0xd65f03c0); // ret
+    return code.size() < (1ull << 27); // Range of the b instruction
+}
+
+#endif
+
+typedef void (*JitFunction)(uint8_t **pointers, JitIO *io);
+
+//Write the code, then make it executable but no longer writable. Null on failure; munmap() the function after use.
+static JitFunction jit_load(const std::vector<uint8_t> & code)
+{
+    void *buffer = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(buffer == MAP_FAILED)
+        return nullptr;
+    memcpy(buffer, code.data(), code.size());
+    if(mprotect(buffer, code.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(buffer, code.size());
+        return nullptr;
+    }
+    __builtin___clear_cache((char *)buffer, (char *)buffer + code.size());
+    return (JitFunction)buffer;
+}
+#endif
+
+//Compile the MM code to native code and run it. Returns false if that isn't possible here.
+bool execute_jit(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out)
+{
+#ifdef JIT_SUPPORTED
+    std::vector<uint8_t> code;
+    if(!jit_compile(instructions, 0, instructions.size(), false, code))
+        return false;
+    JitFunction program = jit_load(code);
+    if(!program)
+        return false;
+
+    JitIO io{&in, &out};
+    uint8_t *pointers[2] = {tape.cells(), tape.cells()};
+    program(pointers, &io);
+    munmap((void *)program, code.size());
+    return true;
+#else
+    (void)instructions;
+    (void)tape;
+    (void)in;
+    (void)out;
+    return false;
+#endif
+}
+
+// Bytes of a loop's byte code the tiered engine interprets, a body per jump back into it, before compiling the loop to
+// native code. Weighing the jumps by the body keeps a long loop that runs a few times from costing more to compile than
+// it saves, and a short one from waiting long.
+const uint32_t TIER_WORK = 1 << 16;
+
+// Both the budget and the profile of the tiered engine: weighs the jumps back into each loop, and pauses the run at the
+// start of the body of a loop that became hot. A weight of UINT32_MAX marks a loop the JIT can't compile.
+struct TierPolicy : NoProfile
+{
+    TierPolicy(const std::vector<uint8_t> & code) : code(code.data()), work(code.size() + 1), enter(UINT64_MAX) {}
+
+    const uint8_t *code;
+    std::vector<uint32_t> work; // By the code position jumped back to, the start of a loop's body
+    uint64_t enter;             // Where to pause, or UINT64_MAX
+
+    void skip(const uint8_t *, const uint8_t *) {}
+    void back(const uint8_t *from, const uint8_t *to)
+    {
+        uint32_t & weight = work[to - code];
+        if(weight < TIER_WORK)
+            weight += std::min<uint64_t>(from - to, TIER_WORK);
+        else if(weight != UINT32_MAX)
+            enter = to - code;
+    }
+    bool pause(uint64_t at) { return at == enter; }
+};
+
+//Interpret the byte code of a program with 8-bit cells from state, and run the loops it spends the most time in as
+//native code from their next iteration on. Returns false, before running anything, if the JIT can't run here.
+static bool execute_tiered(const Program & program, Tape & tape, InputSource & in, OutputSink & out, PackedState state)
+{
+#ifdef JIT_SUPPORTED
+    // A loop, by the code position of the start of its body
+    struct Loop
+    {
+        uint64_t open;        // Token of its [
+        uint64_t exit;        // Code position after its ]
+        JitFunction function; // Once compiled
+        uint64_t size;
+    };
+    const std::vector<Instr> & tokens = program.tokens;
+    std::vector<uint64_t> starts;
+    pack_tokens<uint8_t>(tokens, &starts);
+    std::map<uint64_t, Loop> loops;
+    for(uint64_t pos = 0; pos < tokens.size(); pos++)
+    {
+        if(tokens[pos].type != InstrType::LOOP_OPEN)
+            continue;
+        const uint64_t close = pos + tokens[pos].jump;
+        loops[starts[pos + 1]] = Loop{pos, close + 1 < tokens.size() ? starts[close + 1] : program.code.size(), nullptr, 0};
+    }
+
+    TierPolicy policy(program.code);
+    JitIO io{&in, &out};
+    while(!run_packed<uint8_t>(program.code, tape, in, out, policy, policy, state))
+    {
+        policy.enter = UINT64_MAX;
+        Loop & loop = loops.at(state.at);
+        if(!loop.function)
+        {
+            std::vector<uint8_t> code;
+            if(jit_compile(tokens, loop.open, loop.open + tokens[loop.open].jump + 1, true, code))
+            {
+                loop.function = jit_load(code);
+                loop.size = code.size();
+            }
+            if(!loop.function)
+            {
+                policy.work[state.at] = UINT32_MAX;
+                continue;
+            }
+        }
+        uint8_t *pointers[2] = {tape.cells() + state.a, tape.cells() + state.b};
+        loop.function(pointers, &io);
+        state = PackedState{loop.exit, pointers[0] - tape.cells(), pointers[1] - tape.cells()};
+    }
+    for(const auto & entry : loops)
+        if(entry.second.function)
+            munmap((void *)entry.second.function, entry.second.size);
+    return true;
+#else
+    (void)program;
+    (void)tape;
+    (void)in;
+    (void)out;
+    (void)state;
+    return false;
+#endif
+}
+
+//Translate the tokens to a C program behaving like execute_tokens(), with the given EOF convention
+//and cells of the given width
+void emit_c(const std::vector<Instr> & instructions, uint64_t tape_size, InputSource::Eof eof, std::ostream & out,
+            unsigned cell_bits)
+{
+    const uint64_t cell_max = cell_bits == 32 ? UINT32_MAX : cell_bits == 16 ? UINT16_MAX : UINT8_MAX;
+    const std::string cell_type = "uint" + std::to_string(cell_bits) + "_t";
+    const std::string on_eof = eof == InputSource::Eof::ZERO ? "*cell = 0;"
+                             : eof == InputSource::Eof::MAX ? "*cell = " + std::to_string(cell_max) + "u;"
+                             : "/* Leave the cell unchanged */";
+    out << "/* Generated by MindMeld --emit-c */\n"
+           "#include <stdint.h>\n"
+           "#include <stdio.h>\n"
+           "#ifdef __unix\n"
+           "#include <termios.h>\n"
+           "#include <unistd.h>\n"
+           "#endif\n"
+           "\n"
+           "static " << cell_type << " tape[" << tape_size << "];\n"
+           "\n"
+           "/* Stores the next input byte in cell, like the interpreter's InputSource */\n"
+           "static void mm_input(" << cell_type << " *cell)\n"
+           "{\n"
+           "    int c;\n"
+           "#ifdef __unix\n"
+           "    if(isatty(0))\n"
+           "    {\n"
+           "        /* Read a key without echo, then echo it, like the interpreter's getch() */\n"
+           "        struct termios old_termios, new_termios;\n"
+           "        fflush(stdout);\n"
+           "        tcgetattr(0, &old_termios);\n"
+           "        new_termios = old_termios;\n"
+           "        new_termios.c_lflag &= ~(ICANON | ECHO);\n"
+           "        tcsetattr(0, TCSANOW, &new_termios);\n"
+           "        c = getchar();\n"
+           "        tcsetattr(0, TCSANOW, &old_termios);\n"
+           "        *cell = c == '\\n' ? '\\r' : c;\n"
+           "        putchar(*cell);\n"
+           "        return;\n"
+           "    }\n"
+           "#endif\n"
+           "    c = getchar();\n"
+           "    if(c != EOF)\n"
+           "        *cell = c;\n"
+           "    else\n"
+           "        " << on_eof << "\n"
+           "}\n"
+           "\n"
+           "int main(void)\n"
+           "{\n"
+           "    " << cell_type << " *a = tape;\n"
+           "    " << cell_type << " *b = tape;\n"
+           "    unsigned long long i;\n"
+           "    (void)a; (void)b; (void)i;\n";
+
+    std::string indent = "    ";
+    for(uint64_t pos = 0; pos < instructions.size(); pos++)
+    {
+        const Instr & ins = instructions[pos];
+        const char *p = ins.ptr == Ptr::A ? "a" : "b";
+        const std::string cell = ins.offset ? std::string(p) + "[" + std::to_string(ins.offset) + "]" : std::string("*") + p;
+        if(ins.type == InstrType::LOOP_CLOSE)
+            indent.resize(indent.size() - 4);
+        out << indent;
+        switch(ins.type)
+        {
+            case InstrType::PLUS:
+                out << "++" << cell << ";\n";
+                break;
+            case InstrType::MINUS:
+                out << "--" << cell << ";\n";
+                break;
+            case InstrType::RIGHT:
+                out << "++" << p << ";\n";
+                break;
+            case InstrType::LEFT:
+                out << "--" << p << ";\n";
+                break;
+            case InstrType::ADD:
+                out << cell << " += " << (ins.jump & cell_max) << "u;\n";
+                break;
+            case InstrType::MOVE:
+                out << p << " += " << (int64_t)ins.jump << ";\n";
+                break;
+            case InstrType::SET_ZERO:
+                out << cell << " = 0;\n";
+                break;
+            case InstrType::MUL_ADD:
+            {
+                const std::string src = std::string(ins.src == Ptr::A ? "a" : "b") + "[" + std::to_string(ins.src_offset) + "]";
+                out << "if(" << src << ") " << p << "[" << ins.offset << "] += " << src
+                    << " * " << (ins.jump & cell_max) << "u;\n";
+                break;
+            }
+            case InstrType::OUTPUT:
+                out << "putchar(" << cell << ");\n";
+                break;
+            case InstrType::CONSECUTIVE_OUTPUT:
+                out << "for(i = 0; i < " << ins.jump << "u; i++) putchar(" << cell << ");\n";
+                break;
+            case InstrType::INPUT:
+                out << "mm_input(" << (ins.offset ? std::string(p) + " + " + std::to_string(ins.offset) : std::string(p)) << ");\n";
+                break;
+            case InstrType::LOOP_OPEN:
+                // A loop closed on the other pointer only tests this one on entry
+                if(instructions[pos + ins.jump].ptr == ins.ptr)
+                    out << "while(*" << p << ") {\n";
+                else
+                    out << "if(*" << p << ") do {\n";
+                indent += "    ";
+                break;
+            case InstrType::LOOP_CLOSE:
+                if(instructions[pos - ins.jump].ptr == ins.ptr)
+                    out << "}\n";
+                else
+                    out << "} while(*" << p << ");\n";
+                break;
+        }
+    }
+    out << "    return 0;\n"
+           "}\n";
+}
+
+#define INSTANTIATE_CELLS(Cell) \
+    template uint64_t optimize<Cell>(std::vector<Instr> & tokens); \
+    template uint64_t eliminate_dead_code<Cell>(std::vector<Instr> & tokens); \
+    template void fold_runs<Cell>(std::vector<Instr> & tokens); \
+    template void recognize_idioms<Cell>(std::vector<Instr> & tokens); \
+    template void execute<Cell>(const char *instructions, Tape & tape, InputSource & in, OutputSink & out); \
+    template void execute_tokens<Cell>(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out); \
+    template void execute_threaded<Cell>(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out); \
+    template void InputSource::refill<Cell>(Cell & cell);
+INSTANTIATE_CELLS(uint8_t)
+INSTANTIATE_CELLS(uint16_t)
+INSTANTIATE_CELLS(uint32_t)
+#undef INSTANTIATE_CELLS
@@ -0,0 +1,369 @@
+/*
+ *  The MindMeld library: compiles MindMeld sources, and runs them on one of several engines.
+ *  The MindMeld command line interpreter in main.cpp is built on it.
+ */
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef __unix
+#include <signal.h>
+#endif
+
+enum class InstrType : uint8_t // Represents a BrainF**k instruction
+{
+    PLUS,
+    MINUS,
+    LEFT,
+    RIGHT,
+    INPUT,
+    OUTPUT,
+    LOOP_OPEN,
+    LOOP_CLOSE,
+    ADD,    // Add jump to the byte (a folded run of PLUS/MINUS)
+    MOVE,   // Move the pointer by (int64_t)jump cells (a folded run of LEFT/RIGHT)
+    SET_ZERO, // Clear the byte (a [-] style loop)
+    MUL_ADD, // Add jump times the byte src_offset cells after src to the byte offset cells after ptr.
+             // The target is left untouched if src's byte is zero, since the loop wouldn't run.
+    CONSECUTIVE_OUTPUT // Output the byte jump times (a folded run of OUTPUT)
+};
+
+enum class Ptr : uint8_t { A, B }; // Designates which pointer to affect
+
+// Represents an (Instruction, Pointer) pair, with a special case for loops
+struct Instr
+{
+    InstrType type;
+    Ptr ptr;
+    Ptr src = Ptr::A;   // MUL_ADD: pointer to the multiplier byte
+    int32_t offset = 0; // Position of the byte affected relative to ptr, for any but moves and loops
+    int32_t src_offset = 0; // MUL_ADD: position of the multiplier byte relative to src
+    uint64_t jump = 0;  // Loops: distance to the matching bracket. ADD/MOVE/MUL_ADD/CONSECUTIVE_OUTPUT: operand
+    uint64_t position = 0; // Offset in the source of the instruction character the token was read or folded from
+};
+
+// Collects the program's output and writes it out in large blocks
+class OutputSink
+{
+public:
+    // An unbuffered sink writes every byte as soon as it is output.
+    // A line buffered sink also writes its buffer out at every newline.
+    OutputSink(std::ostream & stream, bool buffered, bool line_buffered);
+    ~OutputSink();
+
+    void put(uint8_t c)
+    {
+        if(!buffered)
+        {
+            stream << (char)c;
+            return;
+        }
+        buffer[used++] = c;
+        if(used == sizeof(buffer) || (line_buffered && c == '\n'))
+            flush();
+    }
+    void put(uint8_t c, uint64_t count); // Output c count times
+    void write(const char *data, size_t size); // Output size bytes at once
+    void flush();
+
+private:
+    std::ostream & stream;
+    bool buffered;
+    bool line_buffered;
+    uint64_t used = 0;
+    char buffer[1 << 16];
+};
+
+// Supplies the program's input, key by key from the console, or in large blocks from a file or pipe
+class InputSource
+{
+public:
+    enum class Eof { ZERO, MAX, UNCHANGED }; // What an input instruction stores once the input ran out. MAX is the cell's largest value.
+
+    // Console input is read with getch(), anything else is read in blocks through file
+    InputSource(FILE *file, bool console, Eof eof);
+
+    template<typename Cell>
+    void get(Cell & cell)
+    {
+        if(next != end)
+            cell = *next++;
+        else
+            refill(cell);
+    }
+    // The console doesn't echo the keys it hands to the program, so the engines do
+    bool echoes() const { return console; }
+
+private:
+    template<typename Cell>
+    void refill(Cell & cell);
+
+    FILE *file;
+    bool console;
+    Eof eof;
+    const uint8_t *next = nullptr;
+    const uint8_t *end = nullptr;
+    uint8_t buffer[1 << 16];
+};
+
+class TapeImage;
+
+// The data tape both pointers move on. Basically, it's RAM.
+// On unix it is reserved address space between two inaccessible guard regions. Pages are
+// made accessible as the pointers first touch them, and touching a guard ends the program
+// with an error, so the engines never have to check the pointers themselves.
+class Tape
+{
+public:
+    // size zeroed bytes, rounded up to a whole page: a cell takes (cell bits / 8) of them. A checked tape asks the engines
+    // that can to check every access against its bounds themselves, and throw a TapeError for one off the tape.
+    explicit Tape(uint64_t size, bool checked = false);
+    Tape(const Tape &) = delete;
+    Tape & operator=(const Tape &) = delete;
+    ~Tape();
+
+    void reset(); // Zero every cell again, to run another program on the tape
+    void load(const TapeImage & image); // Start the zeroed tape from the image instead, which is no larger
+
+    uint8_t *cells() const { return data; }
+    uint64_t size() const { return length; }
+#ifdef __unix
+    uint64_t used() const { return reserved ? committed : length; } // Bytes the pointers may have touched, all past them are zero
+#else
+    uint64_t used() const { return length; }
+#endif
+    bool checked() const { return checking || allocated != nullptr; } // Also where there are no guards
+
+private:
+#ifdef __unix
+    static void on_fault(int signal, siginfo_t *info, void *context);
+    static thread_local Tape *current; // The tape created or reset last on this thread, which faults are checked against
+
+    uint8_t *reserved = nullptr; // Start of the left guard
+    uint64_t reserved_length = 0;
+    uint64_t committed = 0;      // Accessible bytes from data on
+#endif
+    uint8_t *data = nullptr;
+    uint64_t length = 0;
+    bool checking;
+    std::unique_ptr<uint8_t[]> allocated; // Where no address space could be reserved
+};
+
+// The bytes of a tape its pointers reached, kept to start other tapes from. On Linux they are kept in a
+// memory file, which the tapes started from it map privately: they share its pages until they write to them.
+class TapeImage
+{
+public:
+    explicit TapeImage(const Tape & tape);
+    TapeImage(const uint8_t *bytes, uint64_t length);
+    TapeImage(const TapeImage &) = delete;
+    TapeImage & operator=(const TapeImage &) = delete;
+    ~TapeImage();
+
+    const uint8_t *bytes() const { return view; }
+    uint64_t size() const { return length; }
+
+private:
+    friend class Tape;
+    int file = -1;             // The memory file, if any
+    const uint8_t *view = nullptr; // The bytes, in the file's mapping or in copy
+    uint64_t length = 0;
+    std::vector<uint8_t> copy; // Where there is no memory file
+};
+
+// The source file, mapped into memory
+class SourceFile
+{
+public:
+    SourceFile() = default;
+    SourceFile(const SourceFile &) = delete;
+    SourceFile & operator=(const SourceFile &) = delete;
+    ~SourceFile();
+
+    bool open(const std::string & filename);
+    const char *begin() const { return data; }
+    const char *end() const { return data + length; }
+
+private:
+    const char *data = nullptr;
+    uint64_t length = 0;
+    bool mapped = false;
+    std::vector<char> contents; // Where the file couldn't be mapped
+};
+
+enum class Dialect { TWO_CHAR, SWITCH }; // Whether every instruction names its pointer, or A/B switch it
+
+//Pre-processing functions
+std::string source_sanitize(const char *begin, const char *end);
+std::string switch_sanitize(const char *begin, const char *end);
+
+void tokenize_source(const char *begin, const char *end, Dialect dialect, std::vector<Instr> & out);
+void tokenize(const std::string & source, std::vector<Instr> & out);
+char source_character(InstrType type);
+void print_listing(const std::vector<Instr> & tokens, std::ostream & out);
+
+// The passes and engines templated on Cell are instantiated for uint8_t, uint16_t and uint32_t cells,
+// so that every width gets its own code, with the amounts folded and the cells wrapping at that width.
+
+//Optimization passes
+template<typename Cell = uint8_t> uint64_t optimize(std::vector<Instr> & tokens); // Returns the tokens found dead
+template<typename Cell = uint8_t> void fold_runs(std::vector<Instr> & tokens);
+template<typename Cell = uint8_t> void recognize_idioms(std::vector<Instr> & tokens);
+template<typename Cell = uint8_t> uint64_t eliminate_dead_code(std::vector<Instr> & tokens); // Returns the tokens removed
+void fold_offsets(std::vector<Instr> & tokens);
+void link_loops(std::vector<Instr> & tokens);
+void probe_drifting_loops(std::vector<Instr> & tokens); // What compile() ends with, optimizing or not
+
+//Execution function
+template<typename Cell = uint8_t> void execute(const char *instructions, Tape & tape, InputSource & in, OutputSink & out);
+template<typename Cell = uint8_t> void execute_tokens(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out);
+template<typename Cell = uint8_t> void execute_threaded(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out);
+bool execute_jit(const std::vector<Instr> & instructions, Tape & tape, InputSource & in, OutputSink & out); // 8-bit cells. False if the JIT can't run here
+void profile_tokens(const std::vector<Instr> & instructions, const char *source_begin, const char *source_end,
+                    Tape & tape, InputSource & in, OutputSink & out, std::ostream & report, std::ostream & folded,
+                    unsigned cell_bits = 8);
+
+//Ahead-of-time translation
+void emit_c(const std::vector<Instr> & instructions, uint64_t tape_size, InputSource::Eof eof, std::ostream & out,
+            unsigned cell_bits = 8);
+
+enum class Engine { CHARS, TOKENS, THREADED, JIT, TIERED }; // Selects the execution function
+
+// A source that failed to compile, with the line and column at fault in what()
+class SourceError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// A run that was stopped for moving a pointer off a tape that checks its bounds
+class TapeError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// A run that was stopped for running out of its Limits
+class LimitExceeded : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Bounds on how long a program may run, for programs that can't be trusted to stop. Zero is no bound.
+// The tokens engine charges the steps run, and checks both bounds, at each jump back to the start of a loop.
+struct Limits
+{
+    uint64_t max_steps = 0;  // Byte code instructions, superinstructions counting as one
+    uint64_t timeout_ms = 0; // Wall-clock time
+};
+
+// What the tokens engine counts of a run when asked to, for --perf-stats
+struct RunStats
+{
+    bool counted = false;              // Whether the run was on the tokens engine, the only one counting
+    uint64_t dispatched = 0;           // Byte code instructions dispatched, superinstructions counting as one
+    uint64_t open_taken = 0;           // LOOP_OPENs that skipped past their loop
+    uint64_t open_not_taken = 0;       // LOOP_OPENs that entered their loop
+    uint64_t close_taken = 0;          // LOOP_CLOSEs that jumped back into their loop
+    uint64_t close_not_taken = 0;      // LOOP_CLOSEs that left their loop
+    uint64_t high_water[2] = {0, 0};   // The furthest cell from the start of the tape A, resp. B, read or wrote
+};
+
+// A program run up to its first input, or for a part of that, once, for runs on any input to go on from instead of running all before it again
+struct Snapshot
+{
+    bool ended = false;              // Whether the program ended without reading any input
+    std::string output;              // What it output up to there
+    uint64_t at = 0;                 // The code position of the instruction to run next, in the program's code
+    int64_t a = 0;                   // The cells A and B are on
+    int64_t b = 0;
+    std::unique_ptr<TapeImage> tape; // The tape there
+};
+
+// The steps, and the output, compile() evaluates of a program's run up to its first input at most
+const uint64_t PREFIX_STEPS = 1 << 24;
+const uint64_t PREFIX_OUTPUT = 1 << 24;
+
+// A program compiled once, to be run any number of times
+struct Program
+{
+    std::string instructions;  // The sanitized source, for the chars engine
+    std::vector<Instr> tokens; // The tokens, optimized unless compiled without
+    std::vector<uint8_t> code; // The tokens packed for the tokens engine
+    unsigned cell_bits = 8;    // The width of the cells the program runs on: 8, 16 or 32
+    uint64_t eliminated = 0;   // The tokens eliminate_dead_code() removed when optimizing it
+    // Its run up to its first input as evaluated when optimizing it, with PREFIX_STEPS and PREFIX_OUTPUT at most,
+    // and without leaving the first bytes of the tape. Null if it was not optimized or stopped before any step.
+    std::shared_ptr<const Snapshot> prefix;
+};
+
+//Sanitize, tokenize, and unless told not to optimize the source, for cells of the given width.
+//Throws a SourceError if it is malformed.
+Program compile(const char *begin, const char *end, Dialect dialect, bool optimize = true, unsigned cell_bits = 8);
+Program compile(const std::string & source, Dialect dialect, bool optimize = true, unsigned cell_bits = 8);
+
+// What a saved program was compiled from, and how: saved programs are looked up by it
+struct ProgramKey
+{
+    uint64_t source_hash = 0; // hash_source() of the raw source
+    Dialect dialect = Dialect::TWO_CHAR;
+    bool optimized = true;
+    unsigned cell_bits = 8;
+};
+
+//Saved programs (.mmc files) hold the sanitized source and the tokens, so loading one skips compiling
+uint64_t hash_source(const char *begin, const char *end);
+bool is_saved_program(const char *begin, const char *end); // Whether the file starts like a saved program
+void save_program(const Program & program, const ProgramKey & key, std::ostream & out);
+//Throws a SourceError if the file isn't a valid program saved by this version
+Program load_program(const char *begin, const char *end, ProgramKey & key);
+
+//Tokenize the source on a thread of its own while running the tokens tokenized so far, for huge sources to start
+//running at once. Only runs are folded. Throws a SourceError once the run reaches a malformed part of the source.
+void run_streaming(const char *begin, const char *end, Dialect dialect, Tape & tape, InputSource & in, OutputSink & out,
+                   unsigned cell_bits = 8);
+
+//Run a compiled program on a zeroed tape of its cells, and return the engine it ran on: the tokens engine where the
+//JIT is unavailable or the cells are wider than 8 bits, for any run with limits, and on a checked tape, such as one
+//without guard pages, whose bounds only the tokens engine checks. Throws a LimitExceeded if the program ran out of them,
+//and a TapeError if it moved a pointer off a checked tape.
+//Runs on the tokens engine count stats, if not null.
+Engine run(const Program & program, Tape & tape, InputSource & in, OutputSink & out, Engine engine = Engine::TOKENS,
+           const Limits & limits = Limits(), RunStats *stats = nullptr);
+
+// Traces (.mmt files) record the run of a program on the tokens engine compactly enough to keep: only the input
+// it read, with a checkpoint of the tape and both pointers every so many steps, each stored as its difference
+// to the last one. Steps are byte code instructions, superinstructions counting as one, as for Limits.
+const uint64_t TRACE_INTERVAL = 1 << 24; // Steps between checkpoints
+
+//Run the program on the tokens engine like run(), and write its trace to trace
+void trace_program(const Program & program, Tape & tape, InputSource & in, OutputSink & out, std::ostream & trace,
+                   uint64_t interval = TRACE_INTERVAL);
+
+// Where a replay stopped
+struct ReplayStop
+{
+    bool ended = false; // Whether the program ran to its end, rather than to the step sought
+    uint64_t steps = 0; // Steps run before stopping
+    uint64_t token = 0; // The token to run next, if it didn't end
+    int64_t a = 0;      // The cells A and B are on
+    int64_t b = 0;
+};
+
+//Run the program again as it ran when the trace was recorded, with the input it read then, and check that it
+//reaches every checkpoint as recorded. With seek, start from the last checkpoint before step seek, leaving out
+//the output before it, and stop at that step. Throws a SourceError if the trace is malformed, was recorded from
+//another program, or with other flags, or the run doesn't go as recorded.
+ReplayStop replay_program(const Program & program, const char *begin, const char *end, Tape & tape, OutputSink & out,
+                          uint64_t seek = UINT64_MAX);
+
+//Run the program on the tokens engine up to its first input, on a tape of its own of size bytes
+Snapshot snapshot_program(const Program & program, uint64_t tape_size, bool checked = false);
+//Run the program on the tokens engine from the snapshot on, on a zeroed tape of the snapshot's size, after writing the
+//output up to there. The same as run() on the tokens engine, without the run up to there.
+void resume(const Program & program, const Snapshot & snapshot, Tape & tape, InputSource & in, OutputSink & out);